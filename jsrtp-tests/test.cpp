@@ -1,8 +1,17 @@
 #include "gtest/gtest.h"
 #include "../jsrtp/cipher.h"
+#include "../jsrtp/aes_fixed.h"
 #include "../jsrtp/container_slice.h"
+#include "../jsrtp/counter_mode.h"
+#include "../jsrtp/gcm.h"
 #include "../jsrtp/hash.h"
 #include "../jsrtp/hmac.h"
+#include "../jsrtp/replay_window.h"
+#include "../jsrtp/sha1_mb.h"
+#include "../jsrtp/srtcp.h"
+#include "../jsrtp/srtp.h"
+#include "../jsrtp/srtp_kdf.h"
+#include <numeric>
 
 
 TEST(AES, sbox)
@@ -47,6 +56,11 @@ TEST(AES, key_schedule)
 	std::array<uint8_t, 16> rk10;
 	std::copy(rk10_it, rk10_it + AES::block_size, rk10.begin());
 	EXPECT_EQ(rk10, e_rk10);
+
+	auto dk0_it = schedule.get_decryption_round_key(0);
+	auto dk10_it = schedule.get_decryption_round_key(10);
+	EXPECT_TRUE(std::equal(dk0_it, dk0_it + AES::block_size, e_rk10.begin()));
+	EXPECT_TRUE(std::equal(dk10_it, dk10_it + AES::block_size, e_rk1.begin()));
 }
 
 
@@ -82,6 +96,244 @@ TEST(AES, decryption)
 }
 
 
+TEST(AES_table, encryption)
+{
+	auto aes_cipher = AES::create(AESImplementation::table);
+
+	std::vector<uint8_t> test_key = { 0x54, 0x68, 0x61, 0x74, 0x73, 0x20, 0x6D, 0x79, 0x20, 0x4B, 0x75, 0x6E, 0x67, 0x20, 0x46, 0x75 };
+	std::vector<uint8_t> plain_text = { 0x54, 0x77, 0x6F, 0x20, 0x4F, 0x6E, 0x65, 0x20, 0x4E, 0x69, 0x6E, 0x65, 0x20, 0x54, 0x77, 0x6F };
+	std::vector<uint8_t> e_cipher_text = { 0x29, 0xC3, 0x50, 0x5F, 0x57, 0x14, 0x20, 0xF6, 0x40, 0x22, 0x99, 0xB3, 0x1A, 0x02, 0xD7, 0x3A };
+
+	aes_cipher->set_key(test_key);
+
+	EXPECT_EQ(aes_cipher->encrypt(plain_text), e_cipher_text);
+	EXPECT_EQ(aes_cipher->decrypt(e_cipher_text), plain_text);
+}
+
+TEST(AES, fips197_key_sizes)
+{
+	std::vector<uint8_t> plain_text = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF };
+	std::vector<std::vector<uint8_t>> e_cipher_texts = {
+		{ 0x69, 0xC4, 0xE0, 0xD8, 0x6A, 0x7B, 0x04, 0x30, 0xD8, 0xCD, 0xB7, 0x80, 0x70, 0xB4, 0xC5, 0x5A },
+		{ 0xDD, 0xA9, 0x7C, 0xA4, 0x86, 0x4C, 0xDF, 0xE0, 0x6E, 0xAF, 0x70, 0xA0, 0xEC, 0x0D, 0x71, 0x91 },
+		{ 0x8E, 0xA2, 0xB7, 0xCA, 0x51, 0x67, 0x45, 0xBF, 0xEA, 0xFC, 0x49, 0x90, 0x4B, 0x49, 0x60, 0x89 } };
+
+	for (std::size_t i = 0; i < e_cipher_texts.size(); ++i)
+	{
+		std::vector<uint8_t> key(16 + 8 * i);
+		std::iota(key.begin(), key.end(), 0);
+
+		for (auto implementation : { AESImplementation::reference, AESImplementation::table, AESImplementation::aesni, AESImplementation::vector_permute })
+		{
+			auto aes_cipher = AES::create(implementation);
+			aes_cipher->set_key(key);
+			EXPECT_EQ(aes_cipher->encrypt(plain_text), e_cipher_texts[i]);
+			EXPECT_EQ(aes_cipher->decrypt(e_cipher_texts[i]), plain_text);
+		}
+	}
+}
+
+TEST(AES_fixed, fips197_key_sizes)
+{
+	std::vector<uint8_t> plain_text = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF };
+	std::vector<std::vector<uint8_t>> e_cipher_texts = {
+		{ 0x69, 0xC4, 0xE0, 0xD8, 0x6A, 0x7B, 0x04, 0x30, 0xD8, 0xCD, 0xB7, 0x80, 0x70, 0xB4, 0xC5, 0x5A },
+		{ 0xDD, 0xA9, 0x7C, 0xA4, 0x86, 0x4C, 0xDF, 0xE0, 0x6E, 0xAF, 0x70, 0xA0, 0xEC, 0x0D, 0x71, 0x91 },
+		{ 0x8E, 0xA2, 0xB7, 0xCA, 0x51, 0x67, 0x45, 0xBF, 0xEA, 0xFC, 0x49, 0x90, 0x4B, 0x49, 0x60, 0x89 } };
+
+	std::vector<std::unique_ptr<Cipher>> ciphers;
+	ciphers.push_back(std::make_unique<AESFixedCipher<128>>());
+	ciphers.push_back(std::make_unique<AESFixedCipher<192>>());
+	ciphers.push_back(std::make_unique<AESFixedCipher<256>>());
+
+	for (std::size_t i = 0; i < ciphers.size(); ++i)
+	{
+		std::vector<uint8_t> key(16 + 8 * i);
+		std::iota(key.begin(), key.end(), 0);
+
+		EXPECT_THROW(ciphers[i]->set_key(std::vector<uint8_t>(key.begin(), key.end() - 8)), std::invalid_argument);
+		ciphers[i]->set_key(key);
+		EXPECT_EQ(ciphers[i]->encrypt(plain_text), e_cipher_texts[i]);
+		EXPECT_EQ(ciphers[i]->decrypt(e_cipher_texts[i]), plain_text);
+	}
+
+	std::vector<uint8_t> key(16);
+	std::iota(key.begin(), key.end(), 0);
+	AES::KeySchedule schedule;
+	schedule.set_key(key);
+
+	AES128 aes128;
+	AES256 aes256;
+	aes128.set_schedule(schedule);
+	EXPECT_THROW(aes256.set_schedule(schedule), std::invalid_argument);
+
+	std::vector<uint8_t> block = plain_text;
+	aes128.encrypt_block(block.data());
+	EXPECT_EQ(block, e_cipher_texts[0]);
+}
+
+TEST(GCM, mcgrew_viega_vectors)
+{
+	std::vector<uint8_t> key = { 0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c, 0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08 };
+	std::vector<uint8_t> iv = { 0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad, 0xde, 0xca, 0xf8, 0x88 };
+	std::vector<uint8_t> aad = { 0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef, 0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef, 0xab, 0xad, 0xda, 0xd2 };
+	std::vector<uint8_t> plain_text = { 0xd9, 0x31, 0x32, 0x25, 0xf8, 0x84, 0x06, 0xe5, 0xa5, 0x59, 0x09, 0xc5, 0xaf, 0xf5, 0x26, 0x9a, 0x86, 0xa7, 0xa9, 0x53, 0x15, 0x34, 0xf7, 0xda, 0x2e, 0x4c, 0x30, 0x3d, 0x8a, 0x31, 0x8a, 0x72, 0x1c, 0x3c, 0x0c, 0x95, 0x95, 0x68, 0x09, 0x53, 0x2f, 0xcf, 0x0e, 0x24, 0x49, 0xa6, 0xb5, 0x25, 0xb1, 0x6a, 0xed, 0xf5, 0xaa, 0x0d, 0xe6, 0x57, 0xba, 0x63, 0x7b, 0x39 };
+	std::vector<uint8_t> cipher_text_e = { 0x42, 0x83, 0x1e, 0xc2, 0x21, 0x77, 0x74, 0x24, 0x4b, 0x72, 0x21, 0xb7, 0x84, 0xd0, 0xd4, 0x9c, 0xe3, 0xaa, 0x21, 0x2f, 0x2c, 0x02, 0xa4, 0xe0, 0x35, 0xc1, 0x7e, 0x23, 0x29, 0xac, 0xa1, 0x2e, 0x21, 0xd5, 0x14, 0xb2, 0x54, 0x66, 0x93, 0x1c, 0x7d, 0x8f, 0x6a, 0x5a, 0xac, 0x84, 0xaa, 0x05, 0x1b, 0xa3, 0x0b, 0x39, 0x6a, 0x0a, 0xac, 0x97, 0x3d, 0x58, 0xe0, 0x91 };
+	std::vector<uint8_t> tag_e = { 0x5b, 0xc9, 0x4f, 0xbc, 0x32, 0x21, 0xa5, 0xdb, 0x94, 0xfa, 0xe9, 0x5a, 0xe7, 0x12, 0x1a, 0x47 };
+
+	for (auto implementation : { GHashImplementation::table, GHashImplementation::clmul })
+	{
+		AESGCM gcm(AES::create(AESImplementation::automatic), implementation);
+		EXPECT_THROW(gcm.set_key(std::vector<uint8_t>(15)), std::invalid_argument);
+		gcm.set_key(key);
+
+		std::vector<uint8_t> data = plain_text;
+		std::vector<uint8_t> tag(AESGCM::tag_size);
+		gcm.encrypt(iv.data(), ConstByteSlice(aad.data(), aad.size()), ByteSlice(data.data(), data.size()), tag.data());
+		EXPECT_EQ(data, cipher_text_e);
+		EXPECT_EQ(tag, tag_e);
+
+		tag[15] ^= 0x01;
+		EXPECT_FALSE(gcm.decrypt(iv.data(), ConstByteSlice(aad.data(), aad.size()), ByteSlice(data.data(), data.size()), tag.data()));
+		EXPECT_EQ(data, cipher_text_e);
+
+		tag[15] ^= 0x01;
+		EXPECT_TRUE(gcm.decrypt(iv.data(), ConstByteSlice(aad.data(), aad.size()), ByteSlice(data.data(), data.size()), tag.data()));
+		EXPECT_EQ(data, plain_text);
+	}
+}
+
+TEST(GCM, aggregated_ghash)
+{
+	std::vector<uint8_t> key(32);
+	std::iota(key.begin(), key.end(), 0);
+	std::vector<uint8_t> iv(AESGCM::iv_size, 0x5a);
+
+	AESGCM table(AES::create(AESImplementation::automatic), GHashImplementation::table);
+	AESGCM clmul(AES::create(AESImplementation::automatic), GHashImplementation::clmul);
+	table.set_key(key);
+	clmul.set_key(key);
+
+	for (std::size_t len = 0; len < 300; len += 7)
+	{
+		std::vector<uint8_t> data_a(len);
+		std::iota(data_a.begin(), data_a.end(), static_cast<uint8_t>(len));
+		std::vector<uint8_t> data_b = data_a;
+		std::vector<uint8_t> aad(len % 37, 0xaa);
+
+		std::vector<uint8_t> tag_a(AESGCM::tag_size);
+		std::vector<uint8_t> tag_b(AESGCM::tag_size);
+		table.encrypt(iv.data(), ConstByteSlice(aad.data(), aad.size()), ByteSlice(data_a.data(), data_a.size()), tag_a.data());
+		clmul.encrypt(iv.data(), ConstByteSlice(aad.data(), aad.size()), ByteSlice(data_b.data(), data_b.size()), tag_b.data());
+		EXPECT_EQ(data_a, data_b);
+		EXPECT_EQ(tag_a, tag_b);
+	}
+}
+
+TEST(AES, pipelined_blocks)
+{
+	std::vector<uint8_t> key(32);
+	std::iota(key.begin(), key.end(), 0x40);
+	std::vector<uint8_t> plain_text(16 * 13);
+	std::iota(plain_text.begin(), plain_text.end(), 0);
+
+	auto reference = AES::create(AESImplementation::reference);
+	reference->set_key(key);
+	auto e_cipher_text = reference->encrypt(plain_text);
+
+	for (auto implementation : { AESImplementation::automatic, AESImplementation::vector_permute })
+	{
+		auto aes_cipher = AES::create(implementation);
+		aes_cipher->set_key(key);
+		auto cipher_text = aes_cipher->encrypt(plain_text);
+
+		EXPECT_EQ(cipher_text, e_cipher_text);
+		EXPECT_EQ(aes_cipher->decrypt(cipher_text), plain_text);
+
+		const AES::KeySchedule& schedule = aes_cipher->schedule;
+		ASSERT_EQ(schedule.get_rounds(), reference->schedule.get_rounds());
+		EXPECT_TRUE(std::equal(schedule.get_round_key(0), schedule.get_round_key(schedule.get_rounds()), reference->schedule.get_round_key(0)));
+		EXPECT_TRUE(std::equal(schedule.get_decryption_round_key(0), schedule.get_decryption_round_key(schedule.get_rounds()), reference->schedule.get_decryption_round_key(0)));
+	}
+}
+
+TEST(AES, preloaded_schedules)
+{
+	std::vector<uint8_t> plain_text = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF };
+	std::vector<std::vector<uint8_t>> e_cipher_texts = {
+		{ 0x69, 0xC4, 0xE0, 0xD8, 0x6A, 0x7B, 0x04, 0x30, 0xD8, 0xCD, 0xB7, 0x80, 0x70, 0xB4, 0xC5, 0x5A },
+		{ 0xDD, 0xA9, 0x7C, 0xA4, 0x86, 0x4C, 0xDF, 0xE0, 0x6E, 0xAF, 0x70, 0xA0, 0xEC, 0x0D, 0x71, 0x91 },
+		{ 0x8E, 0xA2, 0xB7, 0xCA, 0x51, 0x67, 0x45, 0xBF, 0xEA, 0xFC, 0x49, 0x90, 0x4B, 0x49, 0x60, 0x89 } };
+
+	std::vector<AES::KeySchedule> schedules(e_cipher_texts.size());
+	for (std::size_t i = 0; i < schedules.size(); ++i)
+	{
+		std::vector<uint8_t> key(16 + 8 * i);
+		std::iota(key.begin(), key.end(), 0);
+		schedules[i].set_key(key);
+	}
+
+	for (auto implementation : { AESImplementation::reference, AESImplementation::table, AESImplementation::aesni, AESImplementation::vector_permute })
+	{
+		auto aes_cipher = AES::create(implementation);
+		for (std::size_t i : { 2, 0, 1, 0, 2 })
+		{
+			aes_cipher->set_schedule(schedules[i]);
+			EXPECT_EQ(aes_cipher->encrypt(plain_text), e_cipher_texts[i]);
+			EXPECT_EQ(aes_cipher->decrypt(e_cipher_texts[i]), plain_text);
+		}
+	}
+}
+
+TEST(AES_CM, rfc3711_keystream)
+{
+	std::vector<uint8_t> key = { 0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C };
+	AES::state iv = { 0xF0, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA, 0xFB, 0xFC, 0xFD, 0x00, 0x00 };
+	std::vector<uint8_t> e_keystream = {
+		0xE0, 0x3E, 0xAD, 0x09, 0x35, 0xC9, 0x5E, 0x80, 0xE1, 0x66, 0xB1, 0x6D, 0xD9, 0x2B, 0x4E, 0xB4,
+		0xD2, 0x35, 0x13, 0x16, 0x2B, 0x02, 0xD0, 0xF7, 0x2A, 0x43, 0xA2, 0xFE, 0x4A, 0x5F, 0x97, 0xAB,
+		0x41, 0xE9, 0x5B, 0x3B, 0xB0, 0xA2, 0xE8, 0xDD, 0x47, 0x79, 0x01, 0xE4, 0xFC, 0xA8 };
+
+	AESCounterMode aes_cm;
+	aes_cm.set_key(key);
+	aes_cm.set_iv(iv);
+
+	std::vector<uint8_t> keystream(e_keystream.size());
+	aes_cm.apply_keystream(keystream);
+
+	EXPECT_EQ(keystream, e_keystream);
+}
+
+TEST(AES_CM, split_stream)
+{
+	std::vector<uint8_t> key = { 0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C };
+	AES::state iv = { 0xF0, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA, 0xFB, 0xFC, 0xFD, 0xFE, 0xFF };
+	std::vector<uint8_t> plain_text = {
+		0x6B, 0xC1, 0xBE, 0xE2, 0x2E, 0x40, 0x9F, 0x96, 0xE9, 0x3D, 0x7E, 0x11, 0x73, 0x93, 0x17, 0x2A,
+		0xAE, 0x2D, 0x8A, 0x57, 0x1E, 0x03, 0xAC, 0x9C, 0x9E, 0xB7, 0x6F, 0xAC, 0x45, 0xAF, 0x8E, 0x51,
+		0x30, 0xC8, 0x1C, 0x46, 0xA3, 0x5C, 0xE4, 0x11, 0xE5, 0xFB, 0xC1, 0x19, 0x1A, 0x0A, 0x52, 0xEF,
+		0xF6, 0x9F, 0x24, 0x45, 0xDF, 0x4F, 0x9B, 0x17, 0xAD, 0x2B, 0x41, 0x7B, 0xE6, 0x6C, 0x37, 0x10 };
+	std::vector<uint8_t> e_cipher_text = {
+		0x87, 0x4D, 0x61, 0x91, 0xB6, 0x20, 0xE3, 0x26, 0x1B, 0xEF, 0x68, 0x64, 0x99, 0x0D, 0xB6, 0xCE,
+		0x98, 0x06, 0xF6, 0x6B, 0x79, 0x70, 0xFD, 0xFF, 0x86, 0x17, 0x18, 0x7B, 0xB9, 0xFF, 0xFD, 0xFF,
+		0x5A, 0xE4, 0xDF, 0x3E, 0xDB, 0xD5, 0xD3, 0x5E, 0x5B, 0x4F, 0x09, 0x02, 0x0D, 0xB0, 0x3E, 0xAB,
+		0x1E, 0x03, 0x1D, 0xDA, 0x2F, 0xBE, 0x03, 0xD1, 0x79, 0x21, 0x70, 0xA0, 0xF3, 0x00, 0x9C, 0xEE };
+
+	AESCounterMode aes_cm;
+	aes_cm.set_key(key);
+	aes_cm.set_iv(iv);
+
+	std::vector<uint8_t> cipher_text = plain_text;
+	aes_cm.apply_keystream(cipher_text.data(), 7);
+	aes_cm.apply_keystream(cipher_text.data() + 7, 30);
+	aes_cm.apply_keystream(cipher_text.data() + 37, cipher_text.size() - 37);
+	EXPECT_EQ(cipher_text, e_cipher_text);
+
+	aes_cm.set_iv(iv);
+	aes_cm.apply_keystream(cipher_text);
+	EXPECT_EQ(cipher_text, plain_text);
+}
+
 TEST(ContainerSlice, vector_slice_init)
 {
 	std::vector<uint8_t> input = { 0x54, 0x68, 0x61, 0x74, 0x73, 0x20, 0x6D, 0x79, 0x20, 0x4B, 0x75, 0x6E, 0x67, 0x20, 0x46, 0x75 };
@@ -149,6 +401,36 @@ TEST(ContainerSlice, array_slice_change_it)
 	EXPECT_EQ(input, output);
 }
 
+TEST(ContainerSlice, pointer_slice)
+{
+	std::vector<uint8_t> input = { 0x54, 0x68, 0x61, 0x74, 0x73, 0x20, 0x6D, 0x79, 0x20, 0x4B, 0x75, 0x6E, 0x67, 0x20, 0x46, 0x75 };
+	ByteSlice slice(input.data() + 4, 8);
+
+	EXPECT_EQ(slice.size(), 8);
+	EXPECT_EQ(slice.data(), input.data() + 4);
+	EXPECT_EQ(slice.end(), input.data() + 12);
+	EXPECT_EQ(slice[0], 0x73);
+}
+
+TEST(AES, in_place)
+{
+	AES aes_cipher;
+
+	std::vector<uint8_t> test_key = { 0x54, 0x68, 0x61, 0x74, 0x73, 0x20, 0x6D, 0x79, 0x20, 0x4B, 0x75, 0x6E, 0x67, 0x20, 0x46, 0x75 };
+	std::vector<uint8_t> plain_text = { 0x54, 0x77, 0x6F, 0x20, 0x4F, 0x6E, 0x65, 0x20, 0x4E, 0x69, 0x6E, 0x65, 0x20, 0x54, 0x77, 0x6F };
+	std::vector<uint8_t> e_cipher_text = { 0x29, 0xC3, 0x50, 0x5F, 0x57, 0x14, 0x20, 0xF6, 0x40, 0x22, 0x99, 0xB3, 0x1A, 0x02, 0xD7, 0x3A };
+
+	aes_cipher.set_key(test_key);
+
+	std::vector<uint8_t> buffer = plain_text;
+	aes_cipher.encrypt(ByteSlice(buffer.data(), buffer.size()));
+	EXPECT_EQ(buffer, e_cipher_text);
+
+	std::vector<uint8_t> out(buffer.size());
+	aes_cipher.decrypt(ConstByteSlice(buffer.data(), buffer.size()), ByteSlice(out.data(), out.size()));
+	EXPECT_EQ(out, plain_text);
+}
+
 TEST(sha1, sha1)
 {
 	SHA1 hash;
@@ -183,6 +465,179 @@ TEST(sha1, empty)
 	EXPECT_EQ(digest_e, digest);
 }
 
+TEST(sha1, streaming)
+{
+	SHA1 hash;
+	std::vector<uint8_t> chunk(1000, 'a');
+	for (int i = 0; i < 1000; ++i)
+	{
+		hash.append(chunk.data(), i % 2 ? 1 : 999);
+		hash.append(chunk.data(), i % 2 ? 999 : 1);
+	}
+
+	std::vector<uint8_t> digest_e = { 0x34, 0xaa, 0x97, 0x3c, 0xd4, 0xc4, 0xda, 0xa4, 0xf6, 0x1e, 0xeb, 0x2b, 0xdb, 0xad, 0x27, 0x31, 0x65, 0x34, 0x01, 0x6f };
+	EXPECT_EQ(hash.get_digest(), digest_e);
+}
+
+TEST(sha1, compress_blocks)
+{
+	std::vector<uint8_t> message(SHA1::BLOCK_SIZE * 9);
+	std::iota(message.begin(), message.end(), 0);
+
+	SHA1::state portable = SHA1::INITIAL_STATE;
+	SHA1::compress_blocks_portable(portable, message.data(), 9);
+
+	SHA1::state dispatched = SHA1::INITIAL_STATE;
+	SHA1::compress_blocks(dispatched, message.data(), 4);
+	SHA1::compress_blocks(dispatched, message.data() + 4 * SHA1::BLOCK_SIZE, 5);
+
+	EXPECT_EQ(portable, dispatched);
+
+	if (SHA1::ni_supported())
+	{
+		SHA1::state ni = SHA1::INITIAL_STATE;
+		SHA1::compress_blocks_ni(ni, message.data(), 9);
+		EXPECT_EQ(portable, ni);
+	}
+}
+
+TEST(sha1, multi_buffer)
+{
+	std::vector<std::vector<uint8_t>> messages;
+	for (std::size_t len = 0; len < 300; len += 13)
+	{
+		messages.emplace_back(len);
+		std::iota(messages.back().begin(), messages.back().end(), static_cast<uint8_t>(len));
+	}
+
+	std::vector<std::vector<uint8_t>> e_digests;
+	for (auto& message : messages)
+	{
+		SHA1 hash;
+		hash.append(message);
+		e_digests.push_back(hash.get_digest());
+	}
+
+	for (auto finish : { &SHA1MultiBuffer::finish_sse2, &SHA1MultiBuffer::finish_avx2 })
+	{
+		if (finish == &SHA1MultiBuffer::finish_avx2 && !SHA1MultiBuffer::avx2_supported())
+		{
+			continue;
+		}
+
+		std::vector<SHA1MultiBuffer::Job> jobs(messages.size());
+		for (std::size_t i = 0; i < messages.size(); ++i)
+		{
+			jobs[i].data = messages[i].data();
+			jobs[i].len = messages[i].size();
+		}
+
+		finish(jobs.data(), jobs.size());
+
+		for (std::size_t i = 0; i < messages.size(); ++i)
+		{
+			std::vector<uint8_t> digest(SHA1::DIGEST_SIZE);
+			SHA1MultiBuffer::store_digest(jobs[i].h, digest.data());
+			EXPECT_EQ(digest, e_digests[i]);
+		}
+	}
+
+	// More requests than SHA1MultiBuffer::hash takes in one go.
+	std::vector<std::vector<uint8_t>> digests(3 * messages.size(), std::vector<uint8_t>(SHA1::DIGEST_SIZE));
+	std::vector<DigestRequest> requests;
+	for (std::size_t i = 0; i < digests.size(); ++i)
+	{
+		requests.push_back({ messages[i % messages.size()].data(), messages[i % messages.size()].size(), digests[i].data() });
+	}
+
+	SHA1MultiBuffer::hash(requests.data(), requests.size());
+
+	for (std::size_t i = 0; i < digests.size(); ++i)
+	{
+		EXPECT_EQ(digests[i], e_digests[i % messages.size()]);
+	}
+}
+
+
+TEST(sha256, sha256)
+{
+	std::vector<const char*> messages = { "", "abc", "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq" };
+	std::vector<std::vector<uint8_t>> digests_e = {
+		{ 0xe3, 0xb0, 0xc4, 0x42, 0x98, 0xfc, 0x1c, 0x14, 0x9a, 0xfb, 0xf4, 0xc8, 0x99, 0x6f, 0xb9, 0x24, 0x27, 0xae, 0x41, 0xe4, 0x64, 0x9b, 0x93, 0x4c, 0xa4, 0x95, 0x99, 0x1b, 0x78, 0x52, 0xb8, 0x55 },
+		{ 0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23, 0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad },
+		{ 0x24, 0x8d, 0x6a, 0x61, 0xd2, 0x06, 0x38, 0xb8, 0xe5, 0xc0, 0x26, 0x93, 0x0c, 0x3e, 0x60, 0x39, 0xa3, 0x3c, 0xe4, 0x59, 0x64, 0xff, 0x21, 0x67, 0xf6, 0xec, 0xed, 0xd4, 0x19, 0xdb, 0x06, 0xc1 } };
+
+	for (std::size_t i = 0; i < messages.size(); ++i)
+	{
+		SHA256 hash;
+		hash.append(reinterpret_cast<const uint8_t*>(messages[i]), std::strlen(messages[i]));
+		EXPECT_EQ(hash.get_digest(), digests_e[i]);
+	}
+}
+
+TEST(sha256, streaming)
+{
+	SHA256 hash;
+	std::vector<uint8_t> chunk(1000, 'a');
+	for (int i = 0; i < 1000; ++i)
+	{
+		hash.append(chunk.data(), i % 2 ? 1 : 999);
+		hash.append(chunk.data(), i % 2 ? 999 : 1);
+	}
+
+	std::vector<uint8_t> digest_e = { 0xcd, 0xc7, 0x6e, 0x5c, 0x99, 0x14, 0xfb, 0x92, 0x81, 0xa1, 0xc7, 0xe2, 0x84, 0xd7, 0x3e, 0x67, 0xf1, 0x80, 0x9a, 0x48, 0xa4, 0x97, 0x20, 0x0e, 0x04, 0x6d, 0x39, 0xcc, 0xc7, 0x11, 0x2c, 0xd0 };
+	EXPECT_EQ(hash.get_digest(), digest_e);
+}
+
+TEST(sha256, compress_blocks)
+{
+	std::vector<uint8_t> message(SHA256::BLOCK_SIZE * 9);
+	std::iota(message.begin(), message.end(), 0);
+
+	SHA256::state portable = SHA256::INITIAL_STATE;
+	SHA256::compress_blocks_portable(portable, message.data(), 9);
+
+	SHA256::state dispatched = SHA256::INITIAL_STATE;
+	SHA256::compress_blocks(dispatched, message.data(), 4);
+	SHA256::compress_blocks(dispatched, message.data() + 4 * SHA256::BLOCK_SIZE, 5);
+
+	EXPECT_EQ(portable, dispatched);
+
+	if (SHA256::ni_supported())
+	{
+		SHA256::state ni = SHA256::INITIAL_STATE;
+		SHA256::compress_blocks_ni(ni, message.data(), 9);
+		EXPECT_EQ(portable, ni);
+	}
+
+	if (SHA256::avx2_supported())
+	{
+		SHA256::state avx2 = SHA256::INITIAL_STATE;
+		SHA256::compress_blocks_avx2(avx2, message.data(), 9);
+		EXPECT_EQ(portable, avx2);
+	}
+}
+
+TEST(hmac_sha256, rfc4231)
+{
+	std::vector<uint8_t> key(20, 0x0b);
+	std::vector<uint8_t> data = { 'H', 'i', ' ', 'T', 'h', 'e', 'r', 'e' };
+	std::vector<uint8_t> digest_e = { 0xb0, 0x34, 0x4c, 0x61, 0xd8, 0xdb, 0x38, 0x53, 0x5c, 0xa8, 0xaf, 0xce, 0xaf, 0x0b, 0xf1, 0x2b, 0x88, 0x1d, 0xc2, 0x00, 0xc9, 0x83, 0x3d, 0xa7, 0x26, 0xe9, 0x37, 0x6c, 0x2e, 0x32, 0xcf, 0xf7 };
+
+	HMAC hmac(std::make_unique<SHA256>());
+	hmac.set_key(key);
+	hmac.append(data);
+	EXPECT_EQ(hmac.get_digest(), digest_e);
+
+	const char* in = "This is a test using a larger than block-size key and a larger than block-size data. The key needs to be hashed before being used by the HMAC algorithm.";
+	digest_e = { 0x9b, 0x09, 0xff, 0xa7, 0x1b, 0x94, 0x2f, 0xcb, 0x27, 0x63, 0x5f, 0xbc, 0xd5, 0xb0, 0xe9, 0x44, 0xbf, 0xdc, 0x63, 0x64, 0x4f, 0x07, 0x13, 0x93, 0x8a, 0x7f, 0x51, 0x53, 0x5c, 0x3a, 0x35, 0xe2 };
+
+	HMACFixed<SHA256> fixed;
+	fixed.set_key(std::vector<uint8_t>(131, 0xaa));
+	fixed.append(reinterpret_cast<const uint8_t*>(in), std::strlen(in));
+	auto digest = fixed.get_digest();
+	EXPECT_EQ(std::vector<uint8_t>(digest.begin(), digest.end()), digest_e);
+}
 
 TEST(hmac_sha1, test_1)
 {
@@ -214,3 +669,916 @@ TEST(hmac_sha1, test_6)
 	EXPECT_EQ(digest, digest_e);
 }
 
+TEST(hmac_sha1, fixed)
+{
+	std::vector<uint8_t> key(80);
+	std::fill_n(key.begin(), key.size(), 0xAA);
+	const char* in = "Test Using Larger Than Block-Size Key - Hash Key First";
+	std::array<uint8_t, SHA1::DIGEST_SIZE> digest_e = { 0xaa, 0x4a, 0xe5, 0xe1, 0x52, 0x72, 0xd0, 0x0e, 0x95, 0x70, 0x56, 0x37, 0xce, 0x8a, 0x3b, 0x55, 0xed, 0x40, 0x21, 0x12 };
+
+	HMACFixed<SHA1> hmac_sha1;
+	hmac_sha1.set_key(key);
+
+	for (int i = 0; i < 2; ++i)
+	{
+		hmac_sha1.append(reinterpret_cast<const uint8_t*>(in), 20);
+		hmac_sha1.append(ConstByteSlice(reinterpret_cast<const uint8_t*>(in) + 20, std::strlen(in) - 20));
+		EXPECT_EQ(hmac_sha1.get_digest(), digest_e);
+	}
+
+	std::array<uint8_t, SHA1::DIGEST_SIZE> digest;
+	DigestRequest request = { reinterpret_cast<const uint8_t*>(in), std::strlen(in), digest.data() };
+	hmac_sha1.get_digests(&request, 1);
+	EXPECT_EQ(digest, digest_e);
+
+	std::array<uint8_t, SHA1::DIGEST_SIZE + 1> too_long;
+	hmac_sha1.append(reinterpret_cast<const uint8_t*>(in), std::strlen(in));
+	EXPECT_THROW(hmac_sha1.get_digest(ByteSlice(too_long.data(), too_long.size())), std::invalid_argument);
+	EXPECT_EQ(hmac_sha1.get_digest(), digest_e);
+}
+
+TEST(hmac_sha1, reuse_key)
+{
+	std::vector<uint8_t> key = { 'J', 'e', 'f', 'e' };
+	const char* in = "what do ya want for nothing?";
+	std::vector<uint8_t> digest_e = { 0xef, 0xfc, 0xdf, 0x6a, 0xe5, 0xeb, 0x2f, 0xa2, 0xd2, 0x74, 0x16, 0xd5, 0xf1, 0x84, 0xdf, 0x9c, 0x25, 0x9a, 0x7c, 0x79 };
+
+	HMAC hmac_sha1;
+	hmac_sha1.set_key(std::move(key));
+
+	for (int i = 0; i < 3; ++i)
+	{
+		hmac_sha1.append(reinterpret_cast<const uint8_t*>(in), 10);
+		hmac_sha1.append(reinterpret_cast<const uint8_t*>(in) + 10, std::strlen(in) - 10);
+		EXPECT_EQ(hmac_sha1.get_digest(), digest_e);
+	}
+}
+
+TEST(hmac_sha1, truncated_into_buffer)
+{
+	std::vector<uint8_t> key = { 'J', 'e', 'f', 'e' };
+	const char* in = "what do ya want for nothing?";
+	std::vector<uint8_t> tag_e = { 0xef, 0xfc, 0xdf, 0x6a, 0xe5, 0xeb, 0x2f, 0xa2, 0xd2, 0x74, 0x00, 0x00 };
+
+	HMAC hmac_sha1;
+	hmac_sha1.set_key(std::move(key));
+	hmac_sha1.append(ConstByteSlice(reinterpret_cast<const uint8_t*>(in), std::strlen(in)));
+
+	std::vector<uint8_t> tag(12, 0x00);
+	hmac_sha1.get_digest(ByteSlice(tag.data(), 10));
+	EXPECT_EQ(tag, tag_e);
+
+	std::vector<uint8_t> too_long(SHA1::DIGEST_SIZE + 1);
+	hmac_sha1.append(ConstByteSlice(reinterpret_cast<const uint8_t*>(in), std::strlen(in)));
+	EXPECT_THROW(hmac_sha1.get_digest(ByteSlice(too_long.data(), too_long.size())), std::invalid_argument);
+	hmac_sha1.get_digest(ByteSlice(tag.data(), 10));
+	EXPECT_EQ(tag, tag_e);
+}
+
+TEST(hmac_sha1, verify_truncated)
+{
+	std::vector<uint8_t> key = { 'J', 'e', 'f', 'e' };
+	const uint8_t* in = reinterpret_cast<const uint8_t*>("what do ya want for nothing?");
+	std::size_t len = std::strlen(reinterpret_cast<const char*>(in));
+	std::vector<uint8_t> tag = { 0xef, 0xfc, 0xdf, 0x6a, 0xe5, 0xeb, 0x2f, 0xa2, 0xd2, 0x74 };
+
+	HMACFixed<SHA1> fixed;
+	HMAC hmac;
+	fixed.set_key(key);
+	hmac.set_key(key);
+
+	for (std::size_t tag_len : { 4, 10 })
+	{
+		fixed.append(in, len);
+		EXPECT_TRUE(fixed.verify(ConstByteSlice(tag.data(), tag_len)));
+		hmac.append(in, len);
+		EXPECT_TRUE(hmac.verify(ConstByteSlice(tag.data(), tag_len)));
+	}
+
+	tag[3] ^= 0x01;
+	fixed.append(in, len);
+	EXPECT_FALSE(fixed.verify(ConstByteSlice(tag.data(), 4)));
+	hmac.append(in, len);
+	EXPECT_FALSE(hmac.verify(ConstByteSlice(tag.data(), 10)));
+
+	std::vector<uint8_t> too_long(SHA1::DIGEST_SIZE + 1);
+	EXPECT_THROW(fixed.verify(ConstByteSlice(too_long.data(), too_long.size())), std::invalid_argument);
+	EXPECT_THROW(hmac.verify(ConstByteSlice(too_long.data(), too_long.size())), std::invalid_argument);
+}
+
+TEST(hmac_sha1, scatter_gather)
+{
+	std::vector<uint8_t> key(20, 0x0b);
+	std::vector<uint8_t> message(300);
+	std::iota(message.begin(), message.end(), 0);
+
+	HMACFixed<SHA1> contiguous;
+	contiguous.set_key(key);
+	contiguous.append(message.data(), message.size());
+	auto digest_e = contiguous.get_digest();
+
+	std::vector<HashSegment> segments = { { message.data(), 12 }, { message.data() + 12, 0 }, { message.data() + 12, 100 }, { message.data() + 112, 184 }, { message.data() + 296, 4 } };
+
+	HMACFixed<SHA1> fixed;
+	fixed.set_key(key);
+	fixed.append(segments.data(), segments.size());
+	EXPECT_EQ(fixed.get_digest(), digest_e);
+
+	HMAC hmac;
+	hmac.set_key(key);
+	hmac.append(segments.data(), segments.size());
+	EXPECT_EQ(hmac.get_digest(), std::vector<uint8_t>(digest_e.begin(), digest_e.end()));
+
+	SHA256 sha256;
+	sha256.append(message);
+	auto hash_e = sha256.get_digest();
+	std::unique_ptr<HashFunction> hash = std::make_unique<SHA256>();
+	hash->append(segments.data(), segments.size());
+	EXPECT_EQ(hash->get_digest(), hash_e);
+}
+
+TEST(hmac_sha1, batch)
+{
+	std::vector<uint8_t> key(80);
+	std::fill_n(key.begin(), key.size(), 0xAA);
+	const char* in = "Test Using Larger Than Block-Size Key - Hash Key First";
+	std::vector<uint8_t> digest_e = { 0xaa, 0x4a, 0xe5, 0xe1, 0x52, 0x72, 0xd0, 0x0e, 0x95, 0x70, 0x56, 0x37, 0xce, 0x8a, 0x3b, 0x55, 0xed, 0x40, 0x21, 0x12 };
+
+	HMAC hmac_sha1;
+	hmac_sha1.set_key(std::move(key));
+
+	std::vector<std::vector<uint8_t>> digests(11, std::vector<uint8_t>(SHA1::DIGEST_SIZE));
+	std::vector<DigestRequest> requests;
+	for (auto& digest : digests)
+	{
+		requests.push_back({ reinterpret_cast<const uint8_t*>(in), std::strlen(in), digest.data() });
+	}
+	requests[3].len = 7;
+
+	hmac_sha1.get_digests(requests.data(), requests.size());
+
+	hmac_sha1.append(reinterpret_cast<const uint8_t*>(in), 7);
+	auto digest_short = hmac_sha1.get_digest();
+
+	for (std::size_t i = 0; i < digests.size(); ++i)
+	{
+		EXPECT_EQ(digests[i], i == 3 ? digest_short : digest_e);
+	}
+}
+
+static void set_test_session_keys(SRTPSession& session)
+{
+	std::vector<uint8_t> auth_key(SRTPSession::auth_key_size);
+	std::iota(auth_key.begin(), auth_key.end(), 1);
+
+	session.set_session_keys(
+		{ 0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c },
+		{ 0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd },
+		std::move(auth_key));
+}
+
+TEST(SRTP, protect)
+{
+	std::vector<uint8_t> packet = { 0x80, 0x60, 0x12, 0x34, 0x00, 0x00, 0x00, 0x01, 0xde, 0xad, 0xbe, 0xef };
+	std::vector<uint8_t> packet_e = { 0x80, 0x60, 0x12, 0x34, 0x00, 0x00, 0x00, 0x01, 0xde, 0xad, 0xbe, 0xef, 0x36, 0x04, 0x2d, 0x2d, 0x1c, 0x87, 0xcf, 0x07, 0x62, 0x6a, 0xb8, 0xcd, 0xfa, 0x0c, 0xa0, 0xca, 0x1d, 0xda, 0x7d, 0xf1, 0x01, 0xf4, 0xe7, 0x85, 0x2c, 0xe7, 0xea, 0x26, 0x3b, 0x96 };
+	for (uint8_t i = 0; i < 20; ++i)
+	{
+		packet.push_back(i);
+	}
+	std::size_t len = packet.size();
+	packet.resize(len + 10);
+
+	SRTPSession sender;
+	set_test_session_keys(sender);
+	EXPECT_EQ(sender.protect(ByteSlice(packet.data(), packet.size()), len), SRTPStatus::ok);
+	EXPECT_EQ(len, packet_e.size());
+	EXPECT_EQ(packet, packet_e);
+
+	SRTPSession receiver;
+	set_test_session_keys(receiver);
+	EXPECT_EQ(receiver.unprotect(ByteSlice(packet.data(), packet.size()), len), SRTPStatus::ok);
+	EXPECT_EQ(len, 32);
+	for (uint8_t i = 0; i < 20; ++i)
+	{
+		EXPECT_EQ(packet[12 + i], i);
+	}
+}
+
+TEST(SRTP, header_extension_and_short_tag)
+{
+	std::vector<uint8_t> rtp = { 0x91, 0x60, 0x00, 0x07, 0x00, 0x00, 0x10, 0x00, 0x01, 0x02, 0x03, 0x04, 0xca, 0xfe, 0xba, 0xbe, 0xbe, 0xde, 0x00, 0x01, 0x10, 0xff, 0x00, 0x00 };
+	rtp.resize(rtp.size() + 100, 0x5a);
+
+	SRTPSession sender(SRTPProfile::aes128_cm_hmac_sha1_32);
+	SRTPSession receiver(SRTPProfile::aes128_cm_hmac_sha1_32);
+	set_test_session_keys(sender);
+	set_test_session_keys(receiver);
+
+	std::vector<uint8_t> packet(rtp.size() + 3);
+	std::copy(rtp.begin(), rtp.end(), packet.begin());
+	std::size_t len = rtp.size();
+	EXPECT_EQ(sender.protect(ByteSlice(packet.data(), packet.size()), len), SRTPStatus::buffer_too_small);
+
+	packet.resize(rtp.size() + 4);
+	EXPECT_EQ(sender.protect(ByteSlice(packet.data(), packet.size()), len), SRTPStatus::ok);
+	EXPECT_EQ(len, rtp.size() + 4);
+	EXPECT_TRUE(std::equal(rtp.begin(), rtp.begin() + 24, packet.begin()));
+	EXPECT_FALSE(std::equal(rtp.begin() + 24, rtp.end(), packet.begin() + 24));
+
+	std::vector<uint8_t> tampered = packet;
+	tampered[30] ^= 0x01;
+	EXPECT_EQ(receiver.unprotect(ByteSlice(tampered.data(), tampered.size()), len), SRTPStatus::auth_failed);
+	tampered = packet;
+	tampered[19] ^= 0x01;
+	EXPECT_EQ(receiver.unprotect(ByteSlice(tampered.data(), tampered.size()), len), SRTPStatus::auth_failed);
+
+	EXPECT_EQ(receiver.unprotect(ByteSlice(packet.data(), packet.size()), len), SRTPStatus::ok);
+	EXPECT_EQ(len, rtp.size());
+	packet.resize(len);
+	EXPECT_EQ(packet, rtp);
+
+	std::vector<uint8_t> truncated = { 0x90, 0x60, 0x00, 0x07, 0x00, 0x00, 0x10, 0x00, 0x01, 0x02, 0x03, 0x04, 0xbe, 0xde, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00 };
+	len = truncated.size();
+	EXPECT_EQ(receiver.unprotect(ByteSlice(truncated.data(), truncated.size()), len), SRTPStatus::invalid_packet);
+}
+
+TEST(SRTP, roc_rollover)
+{
+	SRTPSession sender;
+	SRTPSession receiver;
+	set_test_session_keys(sender);
+	set_test_session_keys(receiver);
+
+	std::vector<uint16_t> sequence = { 65533, 65534, 65535, 0, 1, 2 };
+	std::vector<std::vector<uint8_t>> packets;
+
+	for (uint16_t seq : sequence)
+	{
+		std::vector<uint8_t> packet = { 0x80, 0x00, static_cast<uint8_t>(seq >> 8), static_cast<uint8_t>(seq), 0x00, 0x00, 0x00, 0x00, 0x11, 0x22, 0x33, 0x44, 0x01, 0x02, 0x03 };
+		std::size_t len = packet.size();
+		packet.resize(len + sender.get_tag_size());
+		EXPECT_EQ(sender.protect(ByteSlice(packet.data(), packet.size()), len), SRTPStatus::ok);
+		packets.push_back(packet);
+	}
+	EXPECT_EQ(sender.get_roc(0x11223344), 1);
+
+	std::vector<std::size_t> arrival = { 0, 1, 3, 2, 4, 5 };
+	std::vector<uint32_t> roc_e = { 0, 0, 1, 1, 1, 1 };
+
+	for (std::size_t i = 0; i < arrival.size(); ++i)
+	{
+		auto& packet = packets[arrival[i]];
+		std::size_t len;
+		EXPECT_EQ(receiver.unprotect(ByteSlice(packet.data(), packet.size()), len), SRTPStatus::ok);
+		EXPECT_EQ(len, 15);
+		EXPECT_EQ(packet[14], 0x03);
+		EXPECT_EQ(receiver.get_roc(0x11223344), roc_e[i]);
+	}
+
+	// A stream still in its first roll over period cannot step back a ROC.
+	SRTPSession early;
+	set_test_session_keys(early);
+
+	for (uint16_t seq : { 100, 65000 })
+	{
+		SRTPSession fresh;
+		set_test_session_keys(fresh);
+		std::vector<uint8_t> packet = { 0x80, 0x00, static_cast<uint8_t>(seq >> 8), static_cast<uint8_t>(seq), 0x00, 0x00, 0x00, 0x00, 0x55, 0x66, 0x77, 0x88, 0x01, 0x02, 0x03 };
+		std::vector<uint8_t> expected = packet;
+		std::size_t len = packet.size();
+		std::size_t expected_len = expected.size();
+		packet.resize(len + early.get_tag_size());
+		expected.resize(expected_len + fresh.get_tag_size());
+		EXPECT_EQ(early.protect(ByteSlice(packet.data(), packet.size()), len), SRTPStatus::ok);
+		EXPECT_EQ(fresh.protect(ByteSlice(expected.data(), expected.size()), expected_len), SRTPStatus::ok);
+		EXPECT_EQ(packet, expected);
+		EXPECT_EQ(early.get_roc(0x55667788), 0u);
+	}
+}
+
+TEST(SRTP, index_exhausted)
+{
+	SRTPSession sender;
+	SRTPSession receiver;
+	set_test_session_keys(sender);
+	set_test_session_keys(receiver);
+	sender.set_roc(0x11223344, 0xFFFFFFFF, 0xFFFF);
+	receiver.set_roc(0x11223344, 0xFFFFFFFF, 0xFFFF);
+
+	std::vector<uint8_t> last = { 0x80, 0x00, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x11, 0x22, 0x33, 0x44, 0x01, 0x02, 0x03 };
+	std::size_t len = last.size();
+	last.resize(len + sender.get_tag_size());
+	EXPECT_EQ(sender.protect(ByteSlice(last.data(), last.size()), len), SRTPStatus::ok);
+	EXPECT_EQ(receiver.unprotect(ByteSlice(last.data(), last.size()), len), SRTPStatus::ok);
+	EXPECT_EQ(receiver.get_roc(0x11223344), 0xFFFFFFFF);
+
+	// The next sequence number would roll the 48-bit index over to 0.
+	std::vector<uint8_t> next = { 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x11, 0x22, 0x33, 0x44, 0x01, 0x02, 0x03 };
+	len = next.size();
+	next.resize(len + sender.get_tag_size());
+	EXPECT_EQ(sender.protect(ByteSlice(next.data(), next.size()), len), SRTPStatus::key_exhausted);
+	EXPECT_EQ(receiver.unprotect(ByteSlice(last.data(), last.size()), len), SRTPStatus::replayed);
+	EXPECT_EQ(receiver.unprotect(ByteSlice(next.data(), next.size()), len), SRTPStatus::key_exhausted);
+	EXPECT_EQ(sender.get_roc(0x11223344), 0xFFFFFFFF);
+}
+
+TEST(SRTP_KDF, rfc3711_session_keys)
+{
+	std::vector<uint8_t> master_key = { 0xE1, 0xF9, 0x7A, 0x0D, 0x3E, 0x01, 0x8B, 0xE0, 0xD6, 0x4F, 0xA3, 0x2C, 0x06, 0xDE, 0x41, 0x39 };
+	std::vector<uint8_t> master_salt = { 0x0E, 0xC6, 0x75, 0xAD, 0x49, 0x8A, 0xFE, 0xEB, 0xB6, 0x96, 0x0B, 0x3A, 0xAB, 0xE6 };
+	std::array<uint8_t, 16> encryption_key_e = { 0xC6, 0x1E, 0x7A, 0x93, 0x74, 0x4F, 0x39, 0xEE, 0x10, 0x73, 0x4A, 0xFE, 0x3F, 0xF7, 0xA0, 0x87 };
+	std::array<uint8_t, 14> salt_e = { 0x30, 0xCB, 0xBC, 0x08, 0x86, 0x3D, 0x8C, 0x85, 0xD4, 0x9D, 0xB3, 0x4A, 0x9A, 0xE1 };
+	std::array<uint8_t, 20> auth_key_e = { 0xCE, 0xBE, 0x32, 0x1F, 0x6F, 0xF7, 0x71, 0x6B, 0x6F, 0xD4, 0xAB, 0x49, 0xAF, 0x25, 0x6A, 0x15, 0x6D, 0x38, 0xBA, 0xA4 };
+
+	SRTPKeyDerivation kdf;
+	kdf.set_master_key(master_key, master_salt);
+
+	SRTPSessionKeys keys;
+	kdf.derive_session_keys(SRTPKeyDerivation::srtp_label, 0x123456, keys);
+	EXPECT_EQ(keys.encryption_key, encryption_key_e);
+	EXPECT_EQ(keys.salt, salt_e);
+	EXPECT_EQ(keys.auth_key, auth_key_e);
+
+	kdf.set_master_key(master_key, master_salt, 1 << 16);
+	EXPECT_EQ(kdf.get_r(0x123456), 0x12);
+	kdf.derive_session_keys(SRTPKeyDerivation::srtp_label, 0xFFFF, keys);
+	EXPECT_EQ(keys.encryption_key, encryption_key_e);
+	kdf.derive_session_keys(SRTPKeyDerivation::srtp_label, 0x10000, keys);
+	EXPECT_NE(keys.encryption_key, encryption_key_e);
+
+	EXPECT_THROW(kdf.set_master_key(master_key, master_salt, 3), std::invalid_argument);
+	EXPECT_THROW(kdf.set_master_key(master_key, {}), std::invalid_argument);
+}
+
+TEST(SRTP, master_key)
+{
+	std::vector<uint8_t> master_key = { 0xE1, 0xF9, 0x7A, 0x0D, 0x3E, 0x01, 0x8B, 0xE0, 0xD6, 0x4F, 0xA3, 0x2C, 0x06, 0xDE, 0x41, 0x39 };
+	std::vector<uint8_t> master_salt = { 0x0E, 0xC6, 0x75, 0xAD, 0x49, 0x8A, 0xFE, 0xEB, 0xB6, 0x96, 0x0B, 0x3A, 0xAB, 0xE6 };
+	std::vector<uint8_t> packet = { 0x80, 0x0f, 0x12, 0x34, 0xde, 0xca, 0xfb, 0xad, 0xca, 0xfe, 0xba, 0xbe, 0xab, 0xab, 0xab, 0xab, 0xab, 0xab, 0xab, 0xab, 0xab, 0xab, 0xab, 0xab, 0xab, 0xab, 0xab, 0xab, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+	std::vector<uint8_t> packet_e = { 0x80, 0x0f, 0x12, 0x34, 0xde, 0xca, 0xfb, 0xad, 0xca, 0xfe, 0xba, 0xbe, 0x4e, 0x55, 0xdc, 0x4c, 0xe7, 0x99, 0x78, 0xd8, 0x8c, 0xa4, 0xd2, 0x15, 0x94, 0x9d, 0x24, 0x02, 0xb7, 0x8d, 0x6a, 0xcc, 0x99, 0xea, 0x17, 0x9b, 0x8d, 0xbb };
+
+	SRTPSession sender;
+	sender.set_master_key(master_key, master_salt);
+
+	std::size_t len = 28;
+	EXPECT_EQ(sender.protect(ByteSlice(packet.data(), packet.size()), len), SRTPStatus::ok);
+	EXPECT_EQ(len, packet_e.size());
+	EXPECT_EQ(packet, packet_e);
+}
+
+TEST(SRTP, key_derivation_rate)
+{
+	std::vector<uint8_t> master_key(SRTPKeyDerivation::master_key_size, 0x42);
+	std::vector<uint8_t> master_salt(SRTPKeyDerivation::master_salt_size, 0x24);
+
+	SRTPSession sender;
+	SRTPSession receiver;
+	SRTPSession static_receiver;
+	sender.set_master_key(master_key, master_salt, 4);
+	receiver.set_master_key(master_key, master_salt, 4);
+	static_receiver.set_master_key(master_key, master_salt);
+
+	for (uint16_t seq = 0; seq < 12; ++seq)
+	{
+		std::vector<uint8_t> packet = { 0x80, 0x00, 0x00, static_cast<uint8_t>(seq), 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08 };
+		std::size_t len = packet.size();
+		packet.resize(len + sender.get_tag_size());
+		EXPECT_EQ(sender.protect(ByteSlice(packet.data(), packet.size()), len), SRTPStatus::ok);
+
+		std::vector<uint8_t> copy = packet;
+		EXPECT_EQ(static_receiver.unprotect(ByteSlice(copy.data(), copy.size()), len), seq < 4 ? SRTPStatus::ok : SRTPStatus::auth_failed);
+		EXPECT_EQ(receiver.unprotect(ByteSlice(packet.data(), packet.size()), len), SRTPStatus::ok);
+		EXPECT_EQ(packet[15], 0x08);
+	}
+
+	// Streams in different derivation windows, alone and batched.
+	std::vector<std::vector<uint8_t>> buffers;
+	for (uint16_t seq = 0; seq < 6; ++seq)
+	{
+		for (uint8_t ssrc : { 0x01, 0x02 })
+		{
+			uint16_t stream_seq = ssrc == 0x01 ? seq : static_cast<uint16_t>(seq + 100);
+			std::vector<uint8_t> packet = { 0x80, 0x00, static_cast<uint8_t>(stream_seq >> 8), static_cast<uint8_t>(stream_seq), 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, ssrc, 0x05, 0x06, 0x07, 0x08 };
+			std::size_t len = packet.size();
+			packet.resize(len + sender.get_tag_size());
+			EXPECT_EQ(sender.protect(ByteSlice(packet.data(), packet.size()), len), SRTPStatus::ok);
+			buffers.push_back(packet);
+		}
+	}
+
+	SRTPSession batch_receiver;
+	batch_receiver.set_master_key(master_key, master_salt, 4);
+	std::vector<SRTPPacket> packets;
+	for (auto& buffer : buffers)
+	{
+		std::vector<uint8_t> copy = buffer;
+		std::size_t len;
+		EXPECT_EQ(receiver.unprotect(ByteSlice(copy.data(), copy.size()), len), SRTPStatus::ok);
+		EXPECT_EQ(copy[15], 0x08);
+		packets.push_back({ &batch_receiver, buffer.data(), buffer.size(), buffer.size(), SRTPStatus::ok });
+	}
+
+	SRTPSession::unprotect_batch(packets.data(), packets.size());
+	for (auto& packet : packets)
+	{
+		EXPECT_EQ(packet.status, SRTPStatus::ok);
+		EXPECT_EQ(packet.data[15], 0x08);
+	}
+}
+
+TEST(ReplayWindow, sliding)
+{
+	ReplayWindow window;
+
+	EXPECT_TRUE(window.update(100));
+	EXPECT_FALSE(window.update(100));
+	EXPECT_TRUE(window.update(98));
+	EXPECT_TRUE(window.update(37));
+	EXPECT_FALSE(window.check(36));
+	EXPECT_FALSE(window.check(98));
+	EXPECT_TRUE(window.check(99));
+
+	EXPECT_TRUE(window.update(163));
+	EXPECT_FALSE(window.check(99));
+	EXPECT_TRUE(window.check(101));
+	EXPECT_FALSE(window.check(163));
+
+	EXPECT_TRUE(window.update(100000));
+	EXPECT_EQ(window.get_highest(), 100000);
+	EXPECT_TRUE(window.check(99999));
+	EXPECT_FALSE(window.check(163));
+
+	EXPECT_THROW(ReplayWindow(32), std::invalid_argument);
+	EXPECT_THROW(ReplayWindow(ReplayWindow::max_size + 1), std::invalid_argument);
+}
+
+TEST(ReplayWindow, large_window_reordering)
+{
+	ReplayWindow window(2000);
+	std::vector<uint64_t> indices(4096);
+	std::iota(indices.begin(), indices.end(), (uint64_t(1) << 40) - 1000);
+
+	for (std::size_t i = 0; i < indices.size(); i += 2)
+	{
+		EXPECT_TRUE(window.update(indices[i]));
+	}
+
+	std::vector<uint64_t> late = { indices[4095 - 1998], indices[4095 - 2002], indices[4094], indices[4093], indices[4095] };
+	bool accepted[5];
+	window.check(late.data(), late.size(), accepted);
+	EXPECT_TRUE(accepted[0]);
+	EXPECT_FALSE(accepted[1]);
+	EXPECT_FALSE(accepted[2]);
+	EXPECT_TRUE(accepted[3]);
+	EXPECT_TRUE(accepted[4]);
+}
+
+TEST(SRTP, replay_rejected)
+{
+	SRTPSession sender;
+	SRTPSession receiver;
+	set_test_session_keys(sender);
+	set_test_session_keys(receiver);
+
+	std::vector<std::vector<uint8_t>> packets;
+	for (uint16_t seq = 1000; seq < 1100; ++seq)
+	{
+		std::vector<uint8_t> packet = { 0x80, 0x00, static_cast<uint8_t>(seq >> 8), static_cast<uint8_t>(seq), 0x00, 0x00, 0x00, 0x00, 0x11, 0x22, 0x33, 0x44, 0x01, 0x02, 0x03 };
+		std::size_t len = packet.size();
+		packet.resize(len + sender.get_tag_size());
+		EXPECT_EQ(sender.protect(ByteSlice(packet.data(), packet.size()), len), SRTPStatus::ok);
+		packets.push_back(packet);
+	}
+
+	std::size_t len;
+	auto copy = packets[50];
+	EXPECT_EQ(receiver.unprotect(ByteSlice(copy.data(), copy.size()), len), SRTPStatus::ok);
+	copy = packets[50];
+	EXPECT_EQ(receiver.unprotect(ByteSlice(copy.data(), copy.size()), len), SRTPStatus::replayed);
+	copy = packets[99];
+	EXPECT_EQ(receiver.unprotect(ByteSlice(copy.data(), copy.size()), len), SRTPStatus::ok);
+	copy = packets[40];
+	EXPECT_EQ(receiver.unprotect(ByteSlice(copy.data(), copy.size()), len), SRTPStatus::ok);
+	copy = packets[10];
+	EXPECT_EQ(receiver.unprotect(ByteSlice(copy.data(), copy.size()), len), SRTPStatus::replayed);
+
+	copy = packets[49];
+	copy[13] ^= 0x01;
+	EXPECT_EQ(receiver.unprotect(ByteSlice(copy.data(), copy.size()), len), SRTPStatus::auth_failed);
+	copy = packets[49];
+	EXPECT_EQ(receiver.unprotect(ByteSlice(copy.data(), copy.size()), len), SRTPStatus::ok);
+}
+
+TEST(SRTP, authenticate_first)
+{
+	SRTPSession sender;
+	SRTPSession receiver;
+	set_test_session_keys(sender);
+	set_test_session_keys(receiver);
+	receiver.set_unprotect_mode(SRTPUnprotectMode::authenticate_first);
+	EXPECT_EQ(receiver.get_unprotect_mode(), SRTPUnprotectMode::authenticate_first);
+
+	std::vector<uint8_t> rtp = { 0x80, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x11, 0x22, 0x33, 0x44, 0x01, 0x02, 0x03, 0x04, 0x05 };
+	std::vector<uint8_t> packet = rtp;
+	std::size_t len = packet.size();
+	packet.resize(len + sender.get_tag_size());
+	EXPECT_EQ(sender.protect(ByteSlice(packet.data(), packet.size()), len), SRTPStatus::ok);
+
+	auto forged = packet;
+	forged[14] ^= 0x01;
+	auto received = forged;
+	EXPECT_EQ(receiver.unprotect(ByteSlice(received.data(), received.size()), len), SRTPStatus::auth_failed);
+	EXPECT_EQ(received, forged);
+	EXPECT_EQ(receiver.unprotect(ByteSlice(received.data(), 5), len), SRTPStatus::invalid_packet);
+
+	received = packet;
+	EXPECT_EQ(receiver.unprotect(ByteSlice(received.data(), received.size()), len), SRTPStatus::ok);
+	EXPECT_EQ(std::vector<uint8_t>(received.begin(), received.begin() + len), rtp);
+
+	std::vector<std::vector<uint8_t>> buffers = { packet, forged };
+	std::vector<SRTPPacket> packets;
+	for (auto& buffer : buffers)
+	{
+		packets.push_back({ &receiver, buffer.data(), buffer.size(), buffer.size(), SRTPStatus::ok });
+	}
+	SRTPSession::unprotect_batch(packets.data(), packets.size());
+	EXPECT_EQ(packets[0].status, SRTPStatus::replayed);
+	EXPECT_EQ(packets[1].status, SRTPStatus::replayed);
+
+	const SRTPRejectCounters& counters = receiver.get_reject_counters();
+	EXPECT_EQ(counters.auth_failed, 1u);
+	EXPECT_EQ(counters.invalid_packet, 1u);
+	EXPECT_EQ(counters.replayed, 2u);
+
+	receiver.reset_reject_counters();
+	EXPECT_EQ(receiver.get_reject_counters().replayed, 0u);
+}
+
+TEST(SRTP, forged_packet_keeps_session_keys)
+{
+	std::vector<uint8_t> master_key(SRTPKeyDerivation::master_key_size, 0x42);
+	std::vector<uint8_t> master_salt(SRTPKeyDerivation::master_salt_size, 0x24);
+
+	for (auto mode : { SRTPUnprotectMode::authenticate_first, SRTPUnprotectMode::fused })
+	{
+		SRTPSession sender;
+		SRTPSession receiver;
+		sender.set_master_key(master_key, master_salt, 4);
+		receiver.set_master_key(master_key, master_salt, 4);
+		receiver.set_unprotect_mode(mode);
+
+		for (uint16_t seq : { 4, 41, 5 })
+		{
+			std::vector<uint8_t> packet = { 0x80, 0x00, 0x00, static_cast<uint8_t>(seq), 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08 };
+			std::size_t len = packet.size();
+			packet.resize(len + sender.get_tag_size());
+			EXPECT_EQ(sender.protect(ByteSlice(packet.data(), packet.size()), len), SRTPStatus::ok);
+
+			if (seq == 41)
+			{
+				packet[12] ^= 0x01;
+				EXPECT_EQ(receiver.unprotect(ByteSlice(packet.data(), packet.size()), len), SRTPStatus::auth_failed);
+			}
+			else
+			{
+				EXPECT_EQ(receiver.unprotect(ByteSlice(packet.data(), packet.size()), len), SRTPStatus::ok);
+			}
+			EXPECT_EQ(receiver.get_current_r(), 1u);
+		}
+	}
+}
+
+TEST(SRTP, keystream_cache)
+{
+	SRTPSession reference;
+	SRTPSession sender;
+	SRTPSession receiver;
+	set_test_session_keys(reference);
+	set_test_session_keys(sender);
+	set_test_session_keys(receiver);
+	sender.set_keystream_cache(4, 100);
+	receiver.set_keystream_cache(4, 100);
+
+	for (uint16_t seq = 0xFFFD; seq != 0x0004; ++seq)
+	{
+		std::size_t payload_len = seq == 0x0001 ? 150 : 60 + seq % 8;
+		std::vector<uint8_t> rtp = { 0x80, 0x00, static_cast<uint8_t>(seq >> 8), static_cast<uint8_t>(seq), 0x00, 0x00, 0x00, 0x00, 0x11, 0x22, 0x33, 0x44 };
+		for (std::size_t i = 0; i < payload_len; ++i)
+		{
+			rtp.push_back(static_cast<uint8_t>(i + seq));
+		}
+
+		std::vector<uint8_t> expected = rtp;
+		std::size_t expected_len = rtp.size();
+		expected.resize(expected_len + reference.get_tag_size());
+		EXPECT_EQ(reference.protect(ByteSlice(expected.data(), expected.size()), expected_len), SRTPStatus::ok);
+
+		std::vector<uint8_t> packet = rtp;
+		std::size_t len = rtp.size();
+		packet.resize(len + sender.get_tag_size());
+		EXPECT_EQ(sender.protect(ByteSlice(packet.data(), packet.size()), len), SRTPStatus::ok);
+		EXPECT_EQ(packet, expected);
+		sender.precompute_keystreams();
+
+		auto forged = packet;
+		forged.back() ^= 0x01;
+		EXPECT_EQ(receiver.unprotect(ByteSlice(forged.data(), forged.size()), len), SRTPStatus::auth_failed);
+
+		EXPECT_EQ(receiver.unprotect(ByteSlice(packet.data(), packet.size()), len), SRTPStatus::ok);
+		EXPECT_EQ(std::vector<uint8_t>(packet.begin(), packet.begin() + len), rtp);
+		receiver.precompute_keystreams(0x11223344);
+	}
+
+	EXPECT_EQ(receiver.get_roc(0x11223344), 1u);
+	EXPECT_THROW(sender.set_keystream_cache(65, 100), std::invalid_argument);
+}
+
+TEST(SRTP, fused_round_trip)
+{
+	SRTPSession sender;
+	SRTPSession receiver;
+	set_test_session_keys(sender);
+	set_test_session_keys(receiver);
+
+	for (std::size_t payload_len : { 0, 1, 51, 52, 53, 115, 116, 1200 })
+	{
+		std::vector<uint8_t> rtp = { 0x90, 0x60, 0x00, 0x07, 0xde, 0xad, 0xbe, 0xef, 0xca, 0xfe, 0xba, 0xbe, 0xbe, 0xde, 0x00, 0x01, 0x10, 0xff, 0x00, 0x00 };
+		for (std::size_t i = 0; i < payload_len; ++i)
+		{
+			rtp.push_back(static_cast<uint8_t>(i * 7));
+		}
+		rtp[3] = static_cast<uint8_t>(payload_len);
+
+		std::vector<uint8_t> packet = rtp;
+		std::size_t len = packet.size();
+		packet.resize(len + sender.get_tag_size());
+		EXPECT_EQ(sender.protect(ByteSlice(packet.data(), packet.size()), len), SRTPStatus::ok);
+
+		auto tampered = packet;
+		tampered[len - 1] ^= 0x80;
+		auto received = tampered;
+		EXPECT_EQ(receiver.unprotect(ByteSlice(received.data(), received.size()), len), SRTPStatus::auth_failed);
+		EXPECT_EQ(received, tampered);
+
+		EXPECT_EQ(receiver.unprotect(ByteSlice(packet.data(), packet.size()), len), SRTPStatus::ok);
+		EXPECT_EQ(std::vector<uint8_t>(packet.begin(), packet.begin() + len), rtp);
+	}
+}
+
+TEST(SRTP, aead_aes_128_gcm)
+{
+	std::vector<uint8_t> key = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f };
+	std::vector<uint8_t> salt = { 0x51, 0x75, 0x69, 0x64, 0x20, 0x70, 0x72, 0x6f, 0x20, 0x71, 0x75, 0x6f };
+	std::vector<uint8_t> packet = { 0x80, 0x40, 0xf1, 0x7b, 0x80, 0x41, 0xf8, 0xd3, 0x55, 0x01, 0xa0, 0xb2, 0x47, 0x61, 0x6c, 0x6c, 0x69, 0x61, 0x20, 0x65, 0x73, 0x74, 0x20, 0x6f, 0x6d, 0x6e, 0x69, 0x73, 0x20, 0x64, 0x69, 0x76, 0x69, 0x73, 0x61, 0x20, 0x69, 0x6e, 0x20, 0x70, 0x61, 0x72, 0x74, 0x65, 0x73, 0x20, 0x74, 0x72, 0x65, 0x73 };
+	std::vector<uint8_t> packet_e = { 0x80, 0x40, 0xf1, 0x7b, 0x80, 0x41, 0xf8, 0xd3, 0x55, 0x01, 0xa0, 0xb2, 0xf2, 0x4d, 0xe3, 0xa3, 0xfb, 0x34, 0xde, 0x6c, 0xac, 0xba, 0x86, 0x1c, 0x9d, 0x7e, 0x4b, 0xca, 0xbe, 0x63, 0x3b, 0xd5, 0x0d, 0x29, 0x4e, 0x6f, 0x42, 0xa5, 0xf4, 0x7a, 0x51, 0xc7, 0xd1, 0x9b, 0x36, 0xde, 0x3a, 0xdf, 0x88, 0x33, 0x89, 0x9d, 0x7f, 0x27, 0xbe, 0xb1, 0x6a, 0x91, 0x52, 0xcf, 0x76, 0x5e, 0xe4, 0x39, 0x0c, 0xce };
+
+	SRTPSession sender(SRTPProfile::aead_aes_128_gcm);
+	SRTPSession receiver(SRTPProfile::aead_aes_128_gcm);
+	EXPECT_THROW(sender.set_session_keys(key, std::vector<uint8_t>(14), {}), std::invalid_argument);
+	EXPECT_THROW(sender.set_session_keys(key, salt, std::vector<uint8_t>(20)), std::invalid_argument);
+	sender.set_session_keys(key, salt, {});
+	receiver.set_session_keys(key, salt, {});
+
+	std::vector<uint8_t> rtp = packet;
+	std::size_t len = packet.size();
+	packet.resize(len + sender.get_tag_size());
+	EXPECT_EQ(sender.protect(ByteSlice(packet.data(), packet.size()), len), SRTPStatus::ok);
+	EXPECT_EQ(len, packet_e.size());
+	EXPECT_EQ(packet, packet_e);
+
+	auto tampered = packet;
+	tampered[20] ^= 0x01;
+	EXPECT_EQ(receiver.unprotect(ByteSlice(tampered.data(), tampered.size()), len), SRTPStatus::auth_failed);
+
+	EXPECT_EQ(receiver.unprotect(ByteSlice(packet.data(), packet.size()), len), SRTPStatus::ok);
+	EXPECT_EQ(std::vector<uint8_t>(packet.begin(), packet.begin() + len), rtp);
+
+	SRTPSession batch_sender(SRTPProfile::aead_aes_128_gcm);
+	SRTPSession batch_receiver(SRTPProfile::aead_aes_128_gcm);
+	batch_sender.set_master_key(key, salt);
+	batch_receiver.set_master_key(key, salt);
+
+	std::vector<std::vector<uint8_t>> buffers(3, rtp);
+	std::vector<SRTPPacket> packets;
+	for (std::size_t i = 0; i < buffers.size(); ++i)
+	{
+		buffers[i][3] = static_cast<uint8_t>(i);
+		buffers[i].resize(rtp.size() + batch_sender.get_tag_size());
+		packets.push_back({ &batch_sender, buffers[i].data(), rtp.size(), buffers[i].size(), SRTPStatus::ok });
+	}
+
+	SRTPSession::protect_batch(packets.data(), packets.size());
+	for (auto& p : packets)
+	{
+		EXPECT_EQ(p.status, SRTPStatus::ok);
+		p.session = &batch_receiver;
+	}
+
+	SRTPSession::unprotect_batch(packets.data(), packets.size());
+	for (std::size_t i = 0; i < packets.size(); ++i)
+	{
+		EXPECT_EQ(packets[i].status, SRTPStatus::ok);
+		EXPECT_EQ(packets[i].len, rtp.size());
+		EXPECT_TRUE(std::equal(rtp.begin() + 12, rtp.end(), buffers[i].begin() + 12));
+	}
+}
+
+TEST(SRTP, batch)
+{
+	SRTPSession single_a;
+	SRTPSession single_b(SRTPProfile::aes128_cm_hmac_sha1_32);
+	SRTPSession sender_a;
+	SRTPSession sender_b(SRTPProfile::aes128_cm_hmac_sha1_32);
+	SRTPSession receiver_a;
+	SRTPSession receiver_b(SRTPProfile::aes128_cm_hmac_sha1_32);
+	set_test_session_keys(single_a);
+	set_test_session_keys(sender_a);
+	set_test_session_keys(receiver_a);
+
+	std::vector<uint8_t> master_key(SRTPKeyDerivation::master_key_size, 0x42);
+	std::vector<uint8_t> master_salt(SRTPKeyDerivation::master_salt_size, 0x24);
+	single_b.set_master_key(master_key, master_salt, 8);
+	sender_b.set_master_key(master_key, master_salt, 8);
+	receiver_b.set_master_key(master_key, master_salt, 8);
+
+	std::vector<std::vector<uint8_t>> packets;
+	std::vector<std::vector<uint8_t>> expected;
+	std::vector<SRTPPacket> batch;
+
+	for (uint16_t i = 0; i < 100; ++i)
+	{
+		bool stream_a = (i % 3) != 0;
+		SRTPSession& single = stream_a ? single_a : single_b;
+
+		std::vector<uint8_t> packet = { 0x80, 0x00, static_cast<uint8_t>(i >> 8), static_cast<uint8_t>(i), 0x00, 0x00, 0x00, 0x00, 0x11, 0x22, 0x33, static_cast<uint8_t>(stream_a) };
+		packet.resize(packet.size() + i * 7 % 200, static_cast<uint8_t>(i));
+		std::size_t len = packet.size();
+		packet.resize(len + single.get_tag_size());
+
+		std::vector<uint8_t> protected_packet = packet;
+		EXPECT_EQ(single.protect(ByteSlice(protected_packet.data(), protected_packet.size()), len), SRTPStatus::ok);
+		expected.push_back(protected_packet);
+		packets.push_back(packet);
+	}
+	packets.push_back({ 0x00, 0x01 });
+
+	for (std::size_t i = 0; i < packets.size(); ++i)
+	{
+		SRTPSession* session = packets[i].size() > 11 && packets[i][11] ? &sender_a : &sender_b;
+		std::size_t len = i < expected.size() ? packets[i].size() - session->get_tag_size() : packets[i].size();
+		batch.push_back({ session, packets[i].data(), len, packets[i].size(), SRTPStatus::ok });
+	}
+
+	SRTPSession::protect_batch(batch.data(), batch.size());
+	for (std::size_t i = 0; i < expected.size(); ++i)
+	{
+		EXPECT_EQ(batch[i].status, SRTPStatus::ok);
+		EXPECT_EQ(batch[i].len, expected[i].size());
+		EXPECT_EQ(packets[i], expected[i]);
+	}
+	EXPECT_EQ(batch.back().status, SRTPStatus::invalid_packet);
+
+	batch.pop_back();
+	packets[5][20] ^= 0x01;
+	batch.push_back(batch[7]);
+	for (auto& packet : batch)
+	{
+		packet.session = packet.session == &sender_a ? &receiver_a : &receiver_b;
+	}
+
+	SRTPSession::unprotect_batch(batch.data(), batch.size());
+	for (std::size_t i = 0; i < expected.size(); ++i)
+	{
+		EXPECT_EQ(batch[i].status, i == 5 ? SRTPStatus::auth_failed : SRTPStatus::ok);
+		if (i != 5)
+		{
+			EXPECT_EQ(batch[i].len, 12 + i * 7 % 200);
+			EXPECT_TRUE(std::all_of(packets[i].begin() + 12, packets[i].begin() + batch[i].len, [i](uint8_t b) { return b == static_cast<uint8_t>(i); }));
+		}
+	}
+	EXPECT_EQ(batch.back().status, SRTPStatus::replayed);
+}
+
+TEST(SRTCP, protect)
+{
+	std::vector<uint8_t> master_key = { 0xE1, 0xF9, 0x7A, 0x0D, 0x3E, 0x01, 0x8B, 0xE0, 0xD6, 0x4F, 0xA3, 0x2C, 0x06, 0xDE, 0x41, 0x39 };
+	std::vector<uint8_t> master_salt = { 0x0E, 0xC6, 0x75, 0xAD, 0x49, 0x8A, 0xFE, 0xEB, 0xB6, 0x96, 0x0B, 0x3A, 0xAB, 0xE6 };
+	std::vector<uint8_t> rtcp = { 0x81, 0xc8, 0x00, 0x0b, 0xca, 0xfe, 0xba, 0xbe, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28 };
+	std::vector<uint8_t> packet_e = { 0x81, 0xc8, 0x00, 0x0b, 0xca, 0xfe, 0xba, 0xbe, 0x1b, 0x35, 0x89, 0x35, 0xa6, 0xc6, 0xc0, 0xd9, 0x44, 0xbc, 0x2e, 0xac, 0x58, 0x11, 0x1a, 0x84, 0x3e, 0x24, 0xb1, 0xf6, 0x8e, 0x99, 0x1b, 0x71, 0x17, 0x98, 0xe1, 0x0b, 0x17, 0xb4, 0x00, 0x73, 0xf5, 0xc9, 0x4c, 0xf3, 0xf1, 0xee, 0x12, 0xf8, 0x80, 0x00, 0x00, 0x00, 0x2c, 0x19, 0x4b, 0xdd, 0xed, 0x41, 0xc0, 0x0b, 0xd9, 0xa0 };
+
+	SRTCPSession sender;
+	SRTCPSession receiver;
+	sender.set_master_key(master_key, master_salt);
+	receiver.set_master_key(master_key, master_salt);
+
+	std::vector<uint8_t> packet = rtcp;
+	std::size_t len = packet.size();
+	packet.resize(len + SRTCPSession::get_overhead());
+	EXPECT_EQ(sender.protect(ByteSlice(packet.data(), packet.size()), len), SRTPStatus::ok);
+	EXPECT_EQ(len, packet_e.size());
+	EXPECT_EQ(packet, packet_e);
+	EXPECT_EQ(sender.get_next_index(0xcafebabe), 1u);
+
+	auto forged = packet;
+	forged[20] ^= 0x01;
+	EXPECT_EQ(receiver.unprotect(ByteSlice(forged.data(), forged.size()), len), SRTPStatus::auth_failed);
+
+	auto received = packet;
+	EXPECT_EQ(receiver.unprotect(ByteSlice(received.data(), received.size()), len), SRTPStatus::ok);
+	EXPECT_EQ(std::vector<uint8_t>(received.begin(), received.begin() + len), rtcp);
+
+	received = packet;
+	EXPECT_EQ(receiver.unprotect(ByteSlice(received.data(), received.size()), len), SRTPStatus::replayed);
+	EXPECT_EQ(receiver.get_reject_counters().replayed, 1u);
+	EXPECT_EQ(receiver.get_reject_counters().auth_failed, 1u);
+
+	sender.set_encryption(false);
+	packet = rtcp;
+	len = packet.size();
+	packet.resize(len + SRTCPSession::get_overhead());
+	EXPECT_EQ(sender.protect(ByteSlice(packet.data(), packet.size()), len), SRTPStatus::ok);
+	EXPECT_TRUE(std::equal(rtcp.begin(), rtcp.end(), packet.begin()));
+	EXPECT_EQ(packet[rtcp.size()] & 0x80, 0);
+	EXPECT_EQ(receiver.unprotect(ByteSlice(packet.data(), packet.size()), len), SRTPStatus::ok);
+	EXPECT_EQ(std::vector<uint8_t>(packet.begin(), packet.begin() + len), rtcp);
+
+	packet = rtcp;
+	packet[3] = 0x0a;
+	len = rtcp.size();
+	packet.resize(len + SRTCPSession::get_overhead());
+	EXPECT_EQ(sender.protect(ByteSlice(packet.data(), packet.size()), len), SRTPStatus::invalid_packet);
+}
+
+TEST(SRTCP, batch)
+{
+	std::vector<uint8_t> key(SRTPKeyDerivation::master_key_size, 0x42);
+	std::vector<uint8_t> salt(SRTPKeyDerivation::master_salt_size, 0x24);
+
+	SRTCPSession single[2];
+	SRTCPSession sender[2];
+	SRTCPSession receiver[2];
+	for (int s = 0; s < 2; ++s)
+	{
+		single[s].set_master_key(key, salt, 4);
+		sender[s].set_master_key(key, salt, 4);
+		receiver[s].set_master_key(key, salt, 4);
+	}
+
+	std::vector<std::vector<uint8_t>> buffers;
+	std::vector<std::vector<uint8_t>> expected;
+	std::vector<SRTCPPacket> packets;
+
+	for (int i = 0; i < 20; ++i)
+	{
+		int s = i % 7 < 4 ? 0 : 1;
+		std::vector<uint8_t> rtcp = { 0x80, 0xc9, 0x00, 0x01, 0x00, 0x00, 0x00, static_cast<uint8_t>(s), 0x81, 0xca, 0x00, 0x02, 0x00, 0x00, 0x00, static_cast<uint8_t>(s), 0x01, 0x02, static_cast<uint8_t>(i), 0x00 };
+		rtcp.resize(rtcp.size() + SRTCPSession::get_overhead());
+
+		std::size_t len = rtcp.size() - SRTCPSession::get_overhead();
+		std::vector<uint8_t> single_packet = rtcp;
+		EXPECT_EQ(single[s].protect(ByteSlice(single_packet.data(), single_packet.size()), len), SRTPStatus::ok);
+		expected.push_back(single_packet);
+		buffers.push_back(rtcp);
+	}
+
+	for (int i = 0; i < 20; ++i)
+	{
+		int s = i % 7 < 4 ? 0 : 1;
+		packets.push_back({ &sender[s], buffers[i].data(), buffers[i].size() - SRTCPSession::get_overhead(), buffers[i].size(), SRTPStatus::ok });
+	}
+
+	SRTCPSession::protect_batch(packets.data(), packets.size());
+	for (int i = 0; i < 20; ++i)
+	{
+		EXPECT_EQ(packets[i].status, SRTPStatus::ok);
+		EXPECT_EQ(buffers[i], expected[i]);
+		packets[i].session = &receiver[i % 7 < 4 ? 0 : 1];
+	}
+
+	buffers[5][12] ^= 0x01;
+	SRTCPSession::unprotect_batch(packets.data(), packets.size());
+	for (int i = 0; i < 20; ++i)
+	{
+		EXPECT_EQ(packets[i].status, i == 5 ? SRTPStatus::auth_failed : SRTPStatus::ok);
+		if (i != 5)
+		{
+			EXPECT_EQ(packets[i].len, buffers[i].size() - SRTCPSession::get_overhead());
+			EXPECT_EQ(buffers[i][18], i);
+		}
+	}
+
+	// A forged index from another derivation window is rejected without
+	// disturbing the keys of the window in use.
+	std::vector<uint8_t> rtcp = { 0x80, 0xc9, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x03, 0x04 };
+	std::vector<uint8_t> packet = rtcp;
+	std::size_t len = rtcp.size();
+	packet.resize(len + SRTCPSession::get_overhead());
+	EXPECT_EQ(sender[0].protect(ByteSlice(packet.data(), packet.size()), len), SRTPStatus::ok);
+
+	auto forged = packet;
+	forged[rtcp.size() + 1] = 0x40;
+	EXPECT_EQ(receiver[0].unprotect(ByteSlice(forged.data(), forged.size()), len), SRTPStatus::auth_failed);
+	EXPECT_EQ(receiver[0].unprotect(ByteSlice(packet.data(), packet.size()), len), SRTPStatus::ok);
+	EXPECT_EQ(std::vector<uint8_t>(packet.begin(), packet.begin() + len), rtcp);
+}
+
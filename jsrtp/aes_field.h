@@ -0,0 +1,87 @@
+#ifndef __AES_FIELD_H__
+#define __AES_FIELD_H__
+
+#include <cstdint>
+#include <array>
+
+class AESField
+{
+public:
+	using table = std::array<uint8_t, 256>;
+
+	constexpr static uint8_t xtime(uint8_t in)
+	{
+		return static_cast<uint8_t>((in << 1) ^ ((in & 0x80) ? 0x1b : 0x00));
+	}
+
+	constexpr static uint8_t mul(uint8_t in, uint8_t mul)
+	{
+		uint8_t out = 0;
+		for (; mul != 0; mul >>= 1)
+		{
+			if (mul & 1)
+			{
+				out ^= in;
+			}
+			in = xtime(in);
+		}
+		return out;
+	}
+
+	constexpr static uint8_t inverse(uint8_t in)
+	{
+		uint8_t out = 1;
+		for (int bit = 7; bit >= 0; --bit)
+		{
+			out = mul(out, out);
+			if ((254 >> bit) & 1)
+			{
+				out = mul(out, in);
+			}
+		}
+		return out;
+	}
+
+	constexpr static uint8_t rotate_left(uint8_t in, int bits)
+	{
+		return static_cast<uint8_t>((in << bits) | (in >> (8 - bits)));
+	}
+
+	constexpr static uint8_t affine(uint8_t in)
+	{
+		return in ^ rotate_left(in, 1) ^ rotate_left(in, 2) ^ rotate_left(in, 3) ^ rotate_left(in, 4) ^ 0x63;
+	}
+
+	constexpr static table make_sbox()
+	{
+		table out = {};
+		for (int i = 0; i < 256; ++i)
+		{
+			out[i] = affine(inverse(static_cast<uint8_t>(i)));
+		}
+		return out;
+	}
+
+	constexpr static table make_inverse_sbox()
+	{
+		table sbox = make_sbox();
+		table out = {};
+		for (int i = 0; i < 256; ++i)
+		{
+			out[sbox[i]] = static_cast<uint8_t>(i);
+		}
+		return out;
+	}
+
+	constexpr static table make_mul_table(uint8_t factor)
+	{
+		table out = {};
+		for (int i = 0; i < 256; ++i)
+		{
+			out[i] = mul(static_cast<uint8_t>(i), factor);
+		}
+		return out;
+	}
+};
+
+#endif
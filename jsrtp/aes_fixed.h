@@ -0,0 +1,272 @@
+#ifndef __AES_FIXED_H__
+#define __AES_FIXED_H__
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+#include "cipher.h"
+
+template<int KeyBits>
+class AESFixed
+{
+public:
+	static_assert(KeyBits == 128 || KeyBits == 192 || KeyBits == 256, "AES key size must be 128, 192 or 256 bits");
+
+	constexpr static int word_size = AES::word_size;
+	constexpr static int block_size = AES::block_size;
+	constexpr static int key_size = KeyBits / 8;
+	constexpr static int round_keys = key_size / word_size + 7;
+
+	void set_key(const uint8_t* key);
+	void set_schedule(const AES::KeySchedule& in_schedule);
+
+	void encrypt_block(uint8_t* block) const;
+	void decrypt_block(uint8_t* block) const;
+	void encrypt_blocks(uint8_t* blocks, std::size_t count) const;
+	void decrypt_blocks(uint8_t* blocks, std::size_t count) const;
+
+private:
+	AES::KeySchedule schedule;
+
+	static void add_key(uint8_t* block, const uint8_t* key);
+	static void sub_shift(uint8_t* block);
+	static void inverse_sub_shift(uint8_t* block);
+	static void mix_columns(uint8_t* block);
+	static void inverse_mix_columns(uint8_t* block);
+
+	void encrypt_round(uint8_t* block, int round) const;
+	void decrypt_round(uint8_t* block, int round) const;
+
+	template<std::size_t... round>
+	void encrypt_rounds(uint8_t* block, std::index_sequence<round...>) const;
+
+	template<std::size_t... round>
+	void decrypt_rounds(uint8_t* block, std::index_sequence<round...>) const;
+};
+
+template<int KeyBits>
+class AESFixedCipher : public Cipher
+{
+public:
+	virtual void set_key(std::vector<uint8_t> key);
+	virtual std::vector<uint8_t> encrypt(std::vector<uint8_t> plain_text);
+	virtual std::vector<uint8_t> decrypt(std::vector<uint8_t> cipher_text);
+	virtual void encrypt(ByteSlice data);
+	virtual void decrypt(ByteSlice data);
+	using Cipher::encrypt;
+	using Cipher::decrypt;
+
+private:
+	AESFixed<KeyBits> aes;
+};
+
+using AES128 = AESFixed<128>;
+using AES192 = AESFixed<192>;
+using AES256 = AESFixed<256>;
+
+template<int KeyBits>
+void AESFixed<KeyBits>::set_key(const uint8_t* key)
+{
+	schedule.set_key(key, key_size);
+}
+
+template<int KeyBits>
+void AESFixed<KeyBits>::set_schedule(const AES::KeySchedule& in_schedule)
+{
+	if (in_schedule.get_rounds() != round_keys)
+	{
+		throw std::invalid_argument("Key schedule does not match key size");
+	}
+
+	schedule = in_schedule;
+}
+
+template<int KeyBits>
+inline void AESFixed<KeyBits>::add_key(uint8_t* block, const uint8_t* key)
+{
+	for (int i = 0; i < block_size; ++i)
+	{
+		block[i] ^= key[i];
+	}
+}
+
+template<int KeyBits>
+inline void AESFixed<KeyBits>::sub_shift(uint8_t* block)
+{
+	std::array<uint8_t, block_size> in;
+	std::copy(block, block + block_size, in.begin());
+
+	for (int column = 0; column < word_size; ++column)
+	{
+		for (int row = 0; row < word_size; ++row)
+		{
+			block[column * word_size + row] = AES::sbox[in[((column + row) % word_size) * word_size + row]];
+		}
+	}
+}
+
+template<int KeyBits>
+inline void AESFixed<KeyBits>::inverse_sub_shift(uint8_t* block)
+{
+	std::array<uint8_t, block_size> in;
+	std::copy(block, block + block_size, in.begin());
+
+	for (int column = 0; column < word_size; ++column)
+	{
+		for (int row = 0; row < word_size; ++row)
+		{
+			block[column * word_size + row] = AES::inverse_sbox[in[((column + word_size - row) % word_size) * word_size + row]];
+		}
+	}
+}
+
+template<int KeyBits>
+inline void AESFixed<KeyBits>::mix_columns(uint8_t* block)
+{
+	for (int column = 0; column < word_size; ++column)
+	{
+		uint8_t* a = block + column * word_size;
+		uint8_t all = a[0] ^ a[1] ^ a[2] ^ a[3];
+		uint8_t a0 = a[0];
+
+		a[0] ^= all ^ AESField::xtime(a[0] ^ a[1]);
+		a[1] ^= all ^ AESField::xtime(a[1] ^ a[2]);
+		a[2] ^= all ^ AESField::xtime(a[2] ^ a[3]);
+		a[3] ^= all ^ AESField::xtime(a[3] ^ a0);
+	}
+}
+
+template<int KeyBits>
+inline void AESFixed<KeyBits>::inverse_mix_columns(uint8_t* block)
+{
+	for (int column = 0; column < word_size; ++column)
+	{
+		uint8_t* a = block + column * word_size;
+		uint8_t u = AESField::xtime(AESField::xtime(a[0] ^ a[2]));
+		uint8_t v = AESField::xtime(AESField::xtime(a[1] ^ a[3]));
+
+		a[0] ^= u;
+		a[1] ^= v;
+		a[2] ^= u;
+		a[3] ^= v;
+	}
+
+	mix_columns(block);
+}
+
+template<int KeyBits>
+inline void AESFixed<KeyBits>::encrypt_round(uint8_t* block, int round) const
+{
+	sub_shift(block);
+	mix_columns(block);
+	add_key(block, schedule.get_round_key(round));
+}
+
+template<int KeyBits>
+inline void AESFixed<KeyBits>::decrypt_round(uint8_t* block, int round) const
+{
+	inverse_sub_shift(block);
+	inverse_mix_columns(block);
+	add_key(block, schedule.get_decryption_round_key(round));
+}
+
+template<int KeyBits>
+template<std::size_t... round>
+inline void AESFixed<KeyBits>::encrypt_rounds(uint8_t* block, std::index_sequence<round...>) const
+{
+	(encrypt_round(block, static_cast<int>(round) + 1), ...);
+}
+
+template<int KeyBits>
+template<std::size_t... round>
+inline void AESFixed<KeyBits>::decrypt_rounds(uint8_t* block, std::index_sequence<round...>) const
+{
+	(decrypt_round(block, static_cast<int>(round) + 1), ...);
+}
+
+template<int KeyBits>
+void AESFixed<KeyBits>::encrypt_block(uint8_t* block) const
+{
+	add_key(block, schedule.get_round_key(0));
+	encrypt_rounds(block, std::make_index_sequence<round_keys - 2>());
+	sub_shift(block);
+	add_key(block, schedule.get_round_key(round_keys - 1));
+}
+
+template<int KeyBits>
+void AESFixed<KeyBits>::decrypt_block(uint8_t* block) const
+{
+	add_key(block, schedule.get_decryption_round_key(0));
+	decrypt_rounds(block, std::make_index_sequence<round_keys - 2>());
+	inverse_sub_shift(block);
+	add_key(block, schedule.get_decryption_round_key(round_keys - 1));
+}
+
+template<int KeyBits>
+void AESFixed<KeyBits>::encrypt_blocks(uint8_t* blocks, std::size_t count) const
+{
+	for (std::size_t block_ind = 0; block_ind < count; ++block_ind)
+	{
+		encrypt_block(blocks + block_ind * block_size);
+	}
+}
+
+template<int KeyBits>
+void AESFixed<KeyBits>::decrypt_blocks(uint8_t* blocks, std::size_t count) const
+{
+	for (std::size_t block_ind = 0; block_ind < count; ++block_ind)
+	{
+		decrypt_block(blocks + block_ind * block_size);
+	}
+}
+
+template<int KeyBits>
+void AESFixedCipher<KeyBits>::set_key(std::vector<uint8_t> key)
+{
+	if (key.size() != AESFixed<KeyBits>::key_size)
+	{
+		throw std::invalid_argument("Invalid key size");
+	}
+
+	aes.set_key(key.data());
+}
+
+template<int KeyBits>
+std::vector<uint8_t> AESFixedCipher<KeyBits>::encrypt(std::vector<uint8_t> plain_text)
+{
+	encrypt(ByteSlice(plain_text.data(), plain_text.size()));
+	return plain_text;
+}
+
+template<int KeyBits>
+std::vector<uint8_t> AESFixedCipher<KeyBits>::decrypt(std::vector<uint8_t> cipher_text)
+{
+	decrypt(ByteSlice(cipher_text.data(), cipher_text.size()));
+	return cipher_text;
+}
+
+template<int KeyBits>
+void AESFixedCipher<KeyBits>::encrypt(ByteSlice data)
+{
+	if (data.size() % AES::block_size != 0)
+	{
+		throw std::invalid_argument("Invalid block length");
+	}
+
+	aes.encrypt_blocks(data.data(), data.size() / AES::block_size);
+}
+
+template<int KeyBits>
+void AESFixedCipher<KeyBits>::decrypt(ByteSlice data)
+{
+	if (data.size() % AES::block_size != 0)
+	{
+		throw std::invalid_argument("Invalid block length");
+	}
+
+	aes.decrypt_blocks(data.data(), data.size() / AES::block_size);
+}
+
+#endif
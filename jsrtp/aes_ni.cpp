@@ -0,0 +1,107 @@
+#include "aes_ni.h"
+#include "cpu_features.h"
+#include <immintrin.h>
+
+namespace
+{
+	template<int N>
+	JSRTP_TARGET("aes,sse2")
+	inline void encrypt_n(uint8_t* blocks, const __m128i* rk, int nr)
+	{
+		__m128i b[N];
+		for (int i = 0; i < N; ++i)
+		{
+			b[i] = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks) + i), rk[0]);
+		}
+
+		for (int round = 1; round < nr; ++round)
+		{
+			for (int i = 0; i < N; ++i)
+			{
+				b[i] = _mm_aesenc_si128(b[i], rk[round]);
+			}
+		}
+
+		for (int i = 0; i < N; ++i)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(blocks) + i, _mm_aesenclast_si128(b[i], rk[nr]));
+		}
+	}
+
+	template<int N>
+	JSRTP_TARGET("aes,sse2")
+	inline void decrypt_n(uint8_t* blocks, const __m128i* rk, int nr)
+	{
+		__m128i b[N];
+		for (int i = 0; i < N; ++i)
+		{
+			b[i] = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks) + i), rk[0]);
+		}
+
+		for (int round = 1; round < nr; ++round)
+		{
+			for (int i = 0; i < N; ++i)
+			{
+				b[i] = _mm_aesdec_si128(b[i], rk[round]);
+			}
+		}
+
+		for (int i = 0; i < N; ++i)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(blocks) + i, _mm_aesdeclast_si128(b[i], rk[nr]));
+		}
+	}
+}
+
+bool AESNI::is_supported()
+{
+	return CPUFeatures::get().aesni;
+}
+
+JSRTP_TARGET("aes,sse2")
+void AESNI::encrypt_blocks(uint8_t* blocks, std::size_t count)
+{
+	const __m128i* rk = reinterpret_cast<const __m128i*>(schedule.get_round_key(0));
+	int nr = rounds - 1;
+
+	for (; count >= pipeline_blocks; count -= pipeline_blocks, blocks += pipeline_blocks * block_size)
+	{
+		encrypt_n<pipeline_blocks>(blocks, rk, nr);
+	}
+
+	if (count >= 4)
+	{
+		encrypt_n<4>(blocks, rk, nr);
+		count -= 4;
+		blocks += 4 * block_size;
+	}
+
+	for (; count > 0; --count, blocks += block_size)
+	{
+		encrypt_n<1>(blocks, rk, nr);
+	}
+}
+
+JSRTP_TARGET("aes,sse2")
+void AESNI::decrypt_blocks(uint8_t* blocks, std::size_t count)
+{
+	const __m128i* rk = reinterpret_cast<const __m128i*>(schedule.get_decryption_round_key(0));
+	int nr = rounds - 1;
+
+	for (; count >= pipeline_blocks; count -= pipeline_blocks, blocks += pipeline_blocks * block_size)
+	{
+		decrypt_n<pipeline_blocks>(blocks, rk, nr);
+	}
+
+	if (count >= 4)
+	{
+		decrypt_n<4>(blocks, rk, nr);
+		count -= 4;
+		blocks += 4 * block_size;
+	}
+
+	for (; count > 0; --count, blocks += block_size)
+	{
+		decrypt_n<1>(blocks, rk, nr);
+	}
+}
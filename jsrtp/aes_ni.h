@@ -0,0 +1,20 @@
+#ifndef __AES_NI_H__
+#define __AES_NI_H__
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include "cipher.h"
+
+class AESNI : public AES
+{
+public:
+	constexpr static int pipeline_blocks = 8;
+
+	virtual void encrypt_blocks(uint8_t* blocks, std::size_t count);
+	virtual void decrypt_blocks(uint8_t* blocks, std::size_t count);
+
+	static bool is_supported();
+};
+
+#endif
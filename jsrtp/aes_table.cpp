@@ -0,0 +1,141 @@
+#include "aes_table.h"
+
+namespace
+{
+	uint32_t load_word(const uint8_t* in)
+	{
+		return (static_cast<uint32_t>(in[0]) << 24) | (static_cast<uint32_t>(in[1]) << 16) |
+			(static_cast<uint32_t>(in[2]) << 8) | static_cast<uint32_t>(in[3]);
+	}
+
+	void store_word(uint8_t* out, uint32_t in)
+	{
+		out[0] = static_cast<uint8_t>(in >> 24);
+		out[1] = static_cast<uint8_t>(in >> 16);
+		out[2] = static_cast<uint8_t>(in >> 8);
+		out[3] = static_cast<uint8_t>(in);
+	}
+}
+
+constexpr uint32_t AESTable::rotate_right(uint32_t in, int bits)
+{
+	return bits == 0 ? in : (in >> bits) | (in << (32 - bits));
+}
+
+constexpr AESTable::Tables AESTable::make_tables()
+{
+	Tables out = {};
+
+	for (int i = 0; i < 256; ++i)
+	{
+		uint8_t s = sbox[i];
+		uint8_t is = inverse_sbox[i];
+
+		uint32_t te = (static_cast<uint32_t>(AESField::mul(s, 2)) << 24) | (static_cast<uint32_t>(s) << 16) |
+			(static_cast<uint32_t>(s) << 8) | static_cast<uint32_t>(AESField::mul(s, 3));
+		uint32_t td = (static_cast<uint32_t>(AESField::mul(is, 14)) << 24) | (static_cast<uint32_t>(AESField::mul(is, 9)) << 16) |
+			(static_cast<uint32_t>(AESField::mul(is, 13)) << 8) | static_cast<uint32_t>(AESField::mul(is, 11));
+
+		for (int t = 0; t < 4; ++t)
+		{
+			out.encrypt[t][i] = rotate_right(te, 8 * t);
+			out.decrypt[t][i] = rotate_right(td, 8 * t);
+		}
+
+		out.sbox[i] = s;
+		out.inverse_sbox[i] = is;
+	}
+
+	return out;
+}
+
+const AESTable::Tables AESTable::tables = AESTable::make_tables();
+
+void AESTable::set_schedule(const KeySchedule& in_schedule)
+{
+	AES::set_schedule(in_schedule);
+
+	for (int i = 0; i < rounds * word_size; ++i)
+	{
+		encryption_keys[i] = load_word(schedule.get_round_key(0) + i * word_size);
+		decryption_keys[i] = load_word(schedule.get_decryption_round_key(0) + i * word_size);
+	}
+}
+
+void AESTable::encrypt_blocks(uint8_t* blocks, std::size_t count)
+{
+	for (std::size_t block_ind = 0; block_ind < count; ++block_ind)
+	{
+		encrypt_block(blocks + block_ind * block_size);
+	}
+}
+
+void AESTable::decrypt_blocks(uint8_t* blocks, std::size_t count)
+{
+	for (std::size_t block_ind = 0; block_ind < count; ++block_ind)
+	{
+		decrypt_block(blocks + block_ind * block_size);
+	}
+}
+
+void AESTable::encrypt_block(uint8_t* block)
+{
+	const auto& te = tables.encrypt;
+	const auto& s = tables.sbox;
+	const uint32_t* rk = encryption_keys.data();
+
+	uint32_t s0 = load_word(block) ^ rk[0];
+	uint32_t s1 = load_word(block + 4) ^ rk[1];
+	uint32_t s2 = load_word(block + 8) ^ rk[2];
+	uint32_t s3 = load_word(block + 12) ^ rk[3];
+
+	for (int round = 1; round < rounds - 1; ++round)
+	{
+		rk += word_size;
+		uint32_t t0 = te[0][s0 >> 24] ^ te[1][(s1 >> 16) & 0xff] ^ te[2][(s2 >> 8) & 0xff] ^ te[3][s3 & 0xff] ^ rk[0];
+		uint32_t t1 = te[0][s1 >> 24] ^ te[1][(s2 >> 16) & 0xff] ^ te[2][(s3 >> 8) & 0xff] ^ te[3][s0 & 0xff] ^ rk[1];
+		uint32_t t2 = te[0][s2 >> 24] ^ te[1][(s3 >> 16) & 0xff] ^ te[2][(s0 >> 8) & 0xff] ^ te[3][s1 & 0xff] ^ rk[2];
+		uint32_t t3 = te[0][s3 >> 24] ^ te[1][(s0 >> 16) & 0xff] ^ te[2][(s1 >> 8) & 0xff] ^ te[3][s2 & 0xff] ^ rk[3];
+		s0 = t0;
+		s1 = t1;
+		s2 = t2;
+		s3 = t3;
+	}
+
+	rk += word_size;
+	store_word(block, ((s[s0 >> 24] << 24) | (s[(s1 >> 16) & 0xff] << 16) | (s[(s2 >> 8) & 0xff] << 8) | s[s3 & 0xff]) ^ rk[0]);
+	store_word(block + 4, ((s[s1 >> 24] << 24) | (s[(s2 >> 16) & 0xff] << 16) | (s[(s3 >> 8) & 0xff] << 8) | s[s0 & 0xff]) ^ rk[1]);
+	store_word(block + 8, ((s[s2 >> 24] << 24) | (s[(s3 >> 16) & 0xff] << 16) | (s[(s0 >> 8) & 0xff] << 8) | s[s1 & 0xff]) ^ rk[2]);
+	store_word(block + 12, ((s[s3 >> 24] << 24) | (s[(s0 >> 16) & 0xff] << 16) | (s[(s1 >> 8) & 0xff] << 8) | s[s2 & 0xff]) ^ rk[3]);
+}
+
+void AESTable::decrypt_block(uint8_t* block)
+{
+	const auto& td = tables.decrypt;
+	const auto& is = tables.inverse_sbox;
+	const uint32_t* rk = decryption_keys.data();
+
+	uint32_t s0 = load_word(block) ^ rk[0];
+	uint32_t s1 = load_word(block + 4) ^ rk[1];
+	uint32_t s2 = load_word(block + 8) ^ rk[2];
+	uint32_t s3 = load_word(block + 12) ^ rk[3];
+
+	for (int round = 1; round < rounds - 1; ++round)
+	{
+		rk += word_size;
+		uint32_t t0 = td[0][s0 >> 24] ^ td[1][(s3 >> 16) & 0xff] ^ td[2][(s2 >> 8) & 0xff] ^ td[3][s1 & 0xff] ^ rk[0];
+		uint32_t t1 = td[0][s1 >> 24] ^ td[1][(s0 >> 16) & 0xff] ^ td[2][(s3 >> 8) & 0xff] ^ td[3][s2 & 0xff] ^ rk[1];
+		uint32_t t2 = td[0][s2 >> 24] ^ td[1][(s1 >> 16) & 0xff] ^ td[2][(s0 >> 8) & 0xff] ^ td[3][s3 & 0xff] ^ rk[2];
+		uint32_t t3 = td[0][s3 >> 24] ^ td[1][(s2 >> 16) & 0xff] ^ td[2][(s1 >> 8) & 0xff] ^ td[3][s0 & 0xff] ^ rk[3];
+		s0 = t0;
+		s1 = t1;
+		s2 = t2;
+		s3 = t3;
+	}
+
+	rk += word_size;
+	store_word(block, ((is[s0 >> 24] << 24) | (is[(s3 >> 16) & 0xff] << 16) | (is[(s2 >> 8) & 0xff] << 8) | is[s1 & 0xff]) ^ rk[0]);
+	store_word(block + 4, ((is[s1 >> 24] << 24) | (is[(s0 >> 16) & 0xff] << 16) | (is[(s3 >> 8) & 0xff] << 8) | is[s2 & 0xff]) ^ rk[1]);
+	store_word(block + 8, ((is[s2 >> 24] << 24) | (is[(s1 >> 16) & 0xff] << 16) | (is[(s0 >> 8) & 0xff] << 8) | is[s3 & 0xff]) ^ rk[2]);
+	store_word(block + 12, ((is[s3 >> 24] << 24) | (is[(s2 >> 16) & 0xff] << 16) | (is[(s1 >> 8) & 0xff] << 8) | is[s0 & 0xff]) ^ rk[3]);
+}
@@ -0,0 +1,40 @@
+#ifndef __AES_TABLE_H__
+#define __AES_TABLE_H__
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include "cipher.h"
+
+class AESTable : public AES
+{
+public:
+	virtual void set_schedule(const KeySchedule& in_schedule);
+	virtual void encrypt_blocks(uint8_t* blocks, std::size_t count);
+	virtual void decrypt_blocks(uint8_t* blocks, std::size_t count);
+
+private:
+	using table = std::array<uint32_t, 256>;
+
+	struct Tables
+	{
+		std::array<table, 4> encrypt;
+		std::array<table, 4> decrypt;
+		table sbox;
+		table inverse_sbox;
+	};
+
+	constexpr static int max_round_key_words = 60;
+
+	std::array<uint32_t, max_round_key_words> encryption_keys = {};
+	std::array<uint32_t, max_round_key_words> decryption_keys = {};
+
+	static const Tables tables;
+	constexpr static Tables make_tables();
+	constexpr static uint32_t rotate_right(uint32_t in, int bits);
+
+	void encrypt_block(uint8_t* block);
+	void decrypt_block(uint8_t* block);
+};
+
+#endif
@@ -0,0 +1,463 @@
+#include "aes_vperm.h"
+#include "cpu_features.h"
+#include "secure_zero.h"
+#include <immintrin.h>
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	constexpr uint8_t gf_mul(uint8_t a, uint8_t b)
+	{
+		uint8_t out = 0;
+		while (b)
+		{
+			if (b & 1)
+			{
+				out ^= a;
+			}
+			a = static_cast<uint8_t>((a << 1) ^ ((a & 0x80) ? 0x1b : 0x00));
+			b >>= 1;
+		}
+		return out;
+	}
+
+	constexpr uint8_t gf_inv(uint8_t in)
+	{
+		uint8_t out = 1;
+		for (int bit = 7; bit >= 0; --bit)
+		{
+			out = gf_mul(out, out);
+			if ((254 >> bit) & 1)
+			{
+				out = gf_mul(out, in);
+			}
+		}
+		return out;
+	}
+
+	constexpr uint8_t rotl8(uint8_t in, int bits)
+	{
+		return static_cast<uint8_t>((in << bits) | (in >> (8 - bits)));
+	}
+
+	constexpr uint8_t affine(uint8_t in)
+	{
+		return in ^ rotl8(in, 1) ^ rotl8(in, 2) ^ rotl8(in, 3) ^ rotl8(in, 4);
+	}
+
+	constexpr uint8_t inverse_affine(uint8_t in)
+	{
+		return rotl8(in, 1) ^ rotl8(in, 3) ^ rotl8(in, 6);
+	}
+
+	// GF(2^4) is embedded in GF(2^8) as the subfield generated by 0x03^17,
+	// and a byte is split into nibbles as x = i * zeta + j * zeta^16 with
+	// zeta + zeta^16 = 1. Inversion then only needs 16-entry tables.
+	struct GF16Basis
+	{
+		std::array<uint8_t, 4> basis = {};
+		uint8_t zeta = 0;
+
+		constexpr uint8_t embed(uint8_t nibble) const
+		{
+			uint8_t out = 0;
+			for (int bit = 0; bit < 4; ++bit)
+			{
+				if ((nibble >> bit) & 1)
+				{
+					out ^= basis[bit];
+				}
+			}
+			return out;
+		}
+
+		constexpr uint8_t extract(uint8_t element) const
+		{
+			for (uint8_t nibble = 0; nibble < 16; ++nibble)
+			{
+				if (embed(nibble) == element)
+				{
+					return nibble;
+				}
+			}
+			return 0;
+		}
+	};
+
+	constexpr GF16Basis make_basis()
+	{
+		GF16Basis out;
+
+		uint8_t beta = 1;
+		for (int i = 0; i < 17; ++i)
+		{
+			beta = gf_mul(beta, 0x03);
+		}
+
+		out.basis[0] = 1;
+		for (int i = 1; i < 4; ++i)
+		{
+			out.basis[i] = gf_mul(out.basis[i - 1], beta);
+		}
+
+		for (int z = 2; z < 256; ++z)
+		{
+			uint8_t conjugate = static_cast<uint8_t>(z);
+			for (int i = 0; i < 4; ++i)
+			{
+				conjugate = gf_mul(conjugate, conjugate);
+			}
+
+			if ((z ^ conjugate) == 1)
+			{
+				out.zeta = static_cast<uint8_t>(z);
+				break;
+			}
+		}
+
+		return out;
+	}
+
+	struct VectorPermuteTables
+	{
+		alignas(16) std::array<uint8_t, 16> inverse = {};
+		alignas(16) std::array<uint8_t, 16> inverse_scaled = {};
+		alignas(16) std::array<uint8_t, 16> encrypt_input_low = {};
+		alignas(16) std::array<uint8_t, 16> encrypt_input_high = {};
+		alignas(16) std::array<uint8_t, 16> encrypt_output_i = {};
+		alignas(16) std::array<uint8_t, 16> encrypt_output_j = {};
+		alignas(16) std::array<uint8_t, 16> decrypt_input_low = {};
+		alignas(16) std::array<uint8_t, 16> decrypt_input_high = {};
+		alignas(16) std::array<uint8_t, 16> decrypt_output_i = {};
+		alignas(16) std::array<uint8_t, 16> decrypt_output_j = {};
+	};
+
+	constexpr VectorPermuteTables make_tables()
+	{
+		VectorPermuteTables out;
+		GF16Basis gf16 = make_basis();
+
+		uint8_t zeta = gf16.zeta;
+		uint8_t zeta_conjugate = zeta ^ 1;
+		uint8_t norm = gf_mul(zeta, zeta_conjugate);
+		uint8_t norm_1 = norm ^ 1;
+		uint8_t scale = gf_inv(norm);
+
+		std::array<uint8_t, 256> split = {};
+		for (uint8_t i = 0; i < 16; ++i)
+		{
+			for (uint8_t j = 0; j < 16; ++j)
+			{
+				uint8_t x = gf_mul(gf16.embed(i), zeta) ^ gf_mul(gf16.embed(j), zeta_conjugate);
+				split[x] = static_cast<uint8_t>((i << 4) | (i ^ j));
+			}
+		}
+
+		for (uint8_t n = 0; n < 16; ++n)
+		{
+			uint8_t hi = static_cast<uint8_t>(n << 4);
+			out.encrypt_input_low[n] = split[n];
+			out.encrypt_input_high[n] = split[hi];
+			out.decrypt_input_low[n] = split[inverse_affine(n)] ^ split[inverse_affine(0x63)];
+			out.decrypt_input_high[n] = split[inverse_affine(hi)];
+
+			if (n == 0)
+			{
+				out.inverse[n] = 0x80;
+				out.inverse_scaled[n] = 0x80;
+				continue;
+			}
+
+			uint8_t inv = gf_inv(gf16.embed(n));
+			out.inverse[n] = gf16.extract(inv);
+			out.inverse_scaled[n] = gf16.extract(gf_mul(scale, inv));
+
+			uint8_t from_i = gf_mul(gf_mul(norm, inv), zeta) ^ gf_mul(gf_mul(norm_1, inv), zeta_conjugate);
+			uint8_t from_j = gf_mul(gf_mul(norm_1, inv), zeta) ^ gf_mul(gf_mul(norm, inv), zeta_conjugate);
+			out.encrypt_output_i[n] = affine(from_i);
+			out.encrypt_output_j[n] = affine(from_j);
+			out.decrypt_output_i[n] = from_i;
+			out.decrypt_output_j[n] = from_j;
+		}
+
+		return out;
+	}
+
+	constexpr VectorPermuteTables tables = make_tables();
+
+	constexpr uint8_t permute(const std::array<uint8_t, 16>& table, uint8_t index)
+	{
+		return (index & 0x80) ? 0 : table[index & 0x0F];
+	}
+
+	constexpr uint8_t invert_split(uint8_t split, const std::array<uint8_t, 16>& output_i, const std::array<uint8_t, 16>& output_j)
+	{
+		uint8_t i = split >> 4;
+		uint8_t k = split & 0x0F;
+		uint8_t j = i ^ k;
+		uint8_t ak = permute(tables.inverse_scaled, k);
+		uint8_t iak = permute(tables.inverse, i) ^ ak;
+		uint8_t jak = permute(tables.inverse, j) ^ ak;
+		uint8_t io = permute(tables.inverse, iak) ^ j;
+		uint8_t jo = permute(tables.inverse, jak) ^ i;
+		return permute(output_i, io) ^ permute(output_j, jo);
+	}
+
+	constexpr bool verify_tables()
+	{
+		for (int x = 0; x < 256; ++x)
+		{
+			uint8_t in = static_cast<uint8_t>(x);
+
+			uint8_t split = tables.encrypt_input_low[in & 0x0F] ^ tables.encrypt_input_high[in >> 4];
+			uint8_t substituted = invert_split(split, tables.encrypt_output_i, tables.encrypt_output_j) ^ 0x63;
+			if (substituted != (affine(gf_inv(in)) ^ 0x63))
+			{
+				return false;
+			}
+
+			split = tables.decrypt_input_low[in & 0x0F] ^ tables.decrypt_input_high[in >> 4];
+			if (invert_split(split, tables.decrypt_output_i, tables.decrypt_output_j) != gf_inv(inverse_affine(in ^ 0x63)))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static_assert(verify_tables(), "Vector permute tables do not reproduce the AES S-box");
+
+	JSRTP_TARGET("ssse3")
+	inline __m128i load_table(const std::array<uint8_t, 16>& table)
+	{
+		return _mm_load_si128(reinterpret_cast<const __m128i*>(table.data()));
+	}
+
+	JSRTP_TARGET("ssse3")
+	inline __m128i invert(__m128i split, const std::array<uint8_t, 16>& output_i, const std::array<uint8_t, 16>& output_j)
+	{
+		const __m128i low_mask = _mm_set1_epi8(0x0F);
+		const __m128i inverse = load_table(tables.inverse);
+
+		__m128i i = _mm_and_si128(_mm_srli_epi16(split, 4), low_mask);
+		__m128i k = _mm_and_si128(split, low_mask);
+		__m128i j = _mm_xor_si128(i, k);
+		__m128i ak = _mm_shuffle_epi8(load_table(tables.inverse_scaled), k);
+		__m128i iak = _mm_xor_si128(_mm_shuffle_epi8(inverse, i), ak);
+		__m128i jak = _mm_xor_si128(_mm_shuffle_epi8(inverse, j), ak);
+		__m128i io = _mm_xor_si128(_mm_shuffle_epi8(inverse, iak), j);
+		__m128i jo = _mm_xor_si128(_mm_shuffle_epi8(inverse, jak), i);
+
+		return _mm_xor_si128(_mm_shuffle_epi8(load_table(output_i), io), _mm_shuffle_epi8(load_table(output_j), jo));
+	}
+
+	JSRTP_TARGET("ssse3")
+	inline __m128i split_nibbles(__m128i in, const std::array<uint8_t, 16>& low, const std::array<uint8_t, 16>& high)
+	{
+		const __m128i low_mask = _mm_set1_epi8(0x0F);
+		__m128i lo = _mm_and_si128(in, low_mask);
+		__m128i hi = _mm_and_si128(_mm_srli_epi16(in, 4), low_mask);
+		return _mm_xor_si128(_mm_shuffle_epi8(load_table(low), lo), _mm_shuffle_epi8(load_table(high), hi));
+	}
+
+	JSRTP_TARGET("ssse3")
+	inline __m128i sub_bytes(__m128i in)
+	{
+		__m128i split = split_nibbles(in, tables.encrypt_input_low, tables.encrypt_input_high);
+		return _mm_xor_si128(invert(split, tables.encrypt_output_i, tables.encrypt_output_j), _mm_set1_epi8(0x63));
+	}
+
+	JSRTP_TARGET("ssse3")
+	inline __m128i inverse_sub_bytes(__m128i in)
+	{
+		__m128i split = split_nibbles(in, tables.decrypt_input_low, tables.decrypt_input_high);
+		return invert(split, tables.decrypt_output_i, tables.decrypt_output_j);
+	}
+
+	JSRTP_TARGET("ssse3")
+	inline __m128i shift_rows(__m128i in)
+	{
+		return _mm_shuffle_epi8(in, _mm_setr_epi8(0, 5, 10, 15, 4, 9, 14, 3, 8, 13, 2, 7, 12, 1, 6, 11));
+	}
+
+	JSRTP_TARGET("ssse3")
+	inline __m128i inverse_shift_rows(__m128i in)
+	{
+		return _mm_shuffle_epi8(in, _mm_setr_epi8(0, 13, 10, 7, 4, 1, 14, 11, 8, 5, 2, 15, 12, 9, 6, 3));
+	}
+
+	JSRTP_TARGET("ssse3")
+	inline __m128i mul2(__m128i in)
+	{
+		__m128i carry = _mm_and_si128(_mm_cmplt_epi8(in, _mm_setzero_si128()), _mm_set1_epi8(0x1b));
+		return _mm_xor_si128(_mm_add_epi8(in, in), carry);
+	}
+
+	JSRTP_TARGET("ssse3")
+	inline __m128i mix_columns(__m128i in)
+	{
+		__m128i rot1 = _mm_shuffle_epi8(in, _mm_setr_epi8(1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12));
+		__m128i rot2 = _mm_shuffle_epi8(in, _mm_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13));
+		__m128i rot3 = _mm_shuffle_epi8(rot1, _mm_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13));
+		return _mm_xor_si128(_mm_xor_si128(mul2(_mm_xor_si128(in, rot1)), rot1), _mm_xor_si128(rot2, rot3));
+	}
+
+	JSRTP_TARGET("ssse3")
+	inline __m128i inverse_mix_columns(__m128i in)
+	{
+		__m128i rot2 = _mm_shuffle_epi8(in, _mm_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13));
+		__m128i mul4 = mul2(mul2(_mm_xor_si128(in, rot2)));
+		return mix_columns(_mm_xor_si128(in, mul4));
+	}
+
+	template<int N>
+	JSRTP_TARGET("ssse3")
+	inline void encrypt_n(uint8_t* blocks, const __m128i* rk, int nr)
+	{
+		__m128i b[N];
+		for (int i = 0; i < N; ++i)
+		{
+			b[i] = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks) + i), rk[0]);
+		}
+
+		for (int round = 1; round < nr; ++round)
+		{
+			for (int i = 0; i < N; ++i)
+			{
+				b[i] = _mm_xor_si128(mix_columns(shift_rows(sub_bytes(b[i]))), rk[round]);
+			}
+		}
+
+		for (int i = 0; i < N; ++i)
+		{
+			b[i] = _mm_xor_si128(shift_rows(sub_bytes(b[i])), rk[nr]);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(blocks) + i, b[i]);
+		}
+	}
+
+	template<int N>
+	JSRTP_TARGET("ssse3")
+	inline void decrypt_n(uint8_t* blocks, const __m128i* rk, int nr)
+	{
+		__m128i b[N];
+		for (int i = 0; i < N; ++i)
+		{
+			b[i] = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks) + i), rk[nr]);
+		}
+
+		for (int round = nr - 1; round > 0; --round)
+		{
+			for (int i = 0; i < N; ++i)
+			{
+				b[i] = inverse_mix_columns(_mm_xor_si128(inverse_sub_bytes(inverse_shift_rows(b[i])), rk[round]));
+			}
+		}
+
+		for (int i = 0; i < N; ++i)
+		{
+			b[i] = _mm_xor_si128(inverse_sub_bytes(inverse_shift_rows(b[i])), rk[0]);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(blocks) + i, b[i]);
+		}
+	}
+
+	JSRTP_TARGET("ssse3")
+	uint32_t substitute_word(uint32_t in)
+	{
+		return static_cast<uint32_t>(_mm_cvtsi128_si32(sub_bytes(_mm_cvtsi32_si128(static_cast<int>(in)))));
+	}
+
+	// Same layout as AES::KeySchedule::derive_decryption_keys, without its table lookups.
+	JSRTP_TARGET("ssse3")
+	void derive_decryption_keys(const uint8_t* round_keys, uint8_t* decryption_keys, int rounds)
+	{
+		const __m128i* rk = reinterpret_cast<const __m128i*>(round_keys);
+		__m128i* dk = reinterpret_cast<__m128i*>(decryption_keys);
+		int nr = rounds - 1;
+
+		_mm_store_si128(dk, _mm_load_si128(rk + nr));
+		for (int round = 1; round < nr; ++round)
+		{
+			_mm_store_si128(dk + round, inverse_mix_columns(_mm_load_si128(rk + nr - round)));
+		}
+		_mm_store_si128(dk + nr, _mm_load_si128(rk));
+	}
+}
+
+bool AESVectorPermute::is_supported()
+{
+	return CPUFeatures::get().ssse3;
+}
+
+void AESVectorPermute::set_key(const uint8_t* key, std::size_t len)
+{
+	rounds = get_nr_rounds(len);
+
+	int n = static_cast<int>(len) / word_size;
+	std::array<uint32_t, max_round_keys * word_size> words = {};
+	std::memcpy(words.data(), key, len);
+
+	uint32_t round_constant = 0x01;
+	for (int i = n; i < rounds * word_size; ++i)
+	{
+		uint32_t temp = words[i - 1];
+		if (i % n == 0)
+		{
+			temp = substitute_word((temp >> 8) | (temp << 24)) ^ round_constant;
+			round_constant = gf_mul(static_cast<uint8_t>(round_constant), 0x02);
+		}
+		else if (n > 6 && i % n == 4)
+		{
+			temp = substitute_word(temp);
+		}
+		words[i] = words[i - n] ^ temp;
+	}
+
+	std::memcpy(round_keys.data(), words.data(), rounds * block_size);
+	secure_zero(words.data(), sizeof(words));
+
+	alignas(16) std::array<uint8_t, max_round_keys * block_size> decryption_keys = {};
+	derive_decryption_keys(round_keys.data(), decryption_keys.data(), rounds);
+	schedule.set_round_keys(round_keys.data(), decryption_keys.data(), rounds);
+	secure_zero(decryption_keys.data(), decryption_keys.size());
+}
+
+void AESVectorPermute::set_schedule(const KeySchedule& in_schedule)
+{
+	AES::set_schedule(in_schedule);
+	std::copy(schedule.get_round_key(0), schedule.get_round_key(rounds), round_keys.begin());
+}
+
+JSRTP_TARGET("ssse3")
+void AESVectorPermute::encrypt_blocks(uint8_t* blocks, std::size_t count)
+{
+	const __m128i* rk = reinterpret_cast<const __m128i*>(round_keys.data());
+	int nr = rounds - 1;
+
+	for (; count >= pipeline_blocks; count -= pipeline_blocks, blocks += pipeline_blocks * block_size)
+	{
+		encrypt_n<pipeline_blocks>(blocks, rk, nr);
+	}
+
+	for (; count > 0; --count, blocks += block_size)
+	{
+		encrypt_n<1>(blocks, rk, nr);
+	}
+}
+
+JSRTP_TARGET("ssse3")
+void AESVectorPermute::decrypt_blocks(uint8_t* blocks, std::size_t count)
+{
+	const __m128i* rk = reinterpret_cast<const __m128i*>(round_keys.data());
+	int nr = rounds - 1;
+
+	for (; count >= pipeline_blocks; count -= pipeline_blocks, blocks += pipeline_blocks * block_size)
+	{
+		decrypt_n<pipeline_blocks>(blocks, rk, nr);
+	}
+
+	for (; count > 0; --count, blocks += block_size)
+	{
+		decrypt_n<1>(blocks, rk, nr);
+	}
+}
@@ -0,0 +1,29 @@
+#ifndef __AES_VPERM_H__
+#define __AES_VPERM_H__
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include "cipher.h"
+
+class AESVectorPermute : public AES
+{
+public:
+	constexpr static int pipeline_blocks = 4;
+
+	using AES::set_key;
+
+	virtual void set_key(const uint8_t* key, std::size_t len);
+	virtual void set_schedule(const KeySchedule& in_schedule);
+	virtual void encrypt_blocks(uint8_t* blocks, std::size_t count);
+	virtual void decrypt_blocks(uint8_t* blocks, std::size_t count);
+
+	static bool is_supported();
+
+private:
+	constexpr static int max_round_keys = 15;
+
+	alignas(16) std::array<uint8_t, max_round_keys * block_size> round_keys = {};
+};
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef __BYTE_ORDER_H__
+#define __BYTE_ORDER_H__
+
+#include <cstdint>
+
+inline uint16_t load_be16(const uint8_t* in)
+{
+	return static_cast<uint16_t>((in[0] << 8) | in[1]);
+}
+
+inline uint32_t load_be32(const uint8_t* in)
+{
+	return (static_cast<uint32_t>(in[0]) << 24) | (static_cast<uint32_t>(in[1]) << 16) | (static_cast<uint32_t>(in[2]) << 8) | in[3];
+}
+
+inline uint64_t load_be64(const uint8_t* in)
+{
+	uint64_t out = 0;
+	for (int i = 0; i < 8; ++i)
+	{
+		out = (out << 8) | in[i];
+	}
+	return out;
+}
+
+inline void store_be32(uint32_t in, uint8_t* out)
+{
+	out[0] = static_cast<uint8_t>(in >> 24);
+	out[1] = static_cast<uint8_t>(in >> 16);
+	out[2] = static_cast<uint8_t>(in >> 8);
+	out[3] = static_cast<uint8_t>(in);
+}
+
+inline void store_be64(uint64_t in, uint8_t* out)
+{
+	for (int i = 7; i >= 0; --i)
+	{
+		out[i] = static_cast<uint8_t>(in);
+		in >>= 8;
+	}
+}
+
+#endif
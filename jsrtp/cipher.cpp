@@ -1,150 +1,154 @@
 #include "cipher.h"
+#include <algorithm>
 #include <iostream>
 #include "container_slice.h"
+#include "aes_table.h"
+#include "aes_ni.h"
+#include "aes_vperm.h"
 
-uint8_t AES::sbox_substitute(uint8_t in)
+namespace
 {
-	return sbox[sbox_get_row(in)][sbox_get_column(in)];
+	struct MulTables
+	{
+		AESField::table mul2;
+		AESField::table mul3;
+		AESField::table mul9;
+		AESField::table mul11;
+		AESField::table mul13;
+		AESField::table mul14;
+	};
+
+	constexpr MulTables mul_tables = {
+		AESField::make_mul_table(2),
+		AESField::make_mul_table(3),
+		AESField::make_mul_table(9),
+		AESField::make_mul_table(11),
+		AESField::make_mul_table(13),
+		AESField::make_mul_table(14)
+	};
+}
+
+void Cipher::encrypt(ConstByteSlice plain_text, ByteSlice cipher_text)
+{
+	if (cipher_text.size() != plain_text.size())
+	{
+		throw std::invalid_argument("Output size does not match input size");
+	}
+
+	std::copy(plain_text.begin(), plain_text.end(), cipher_text.begin());
+	encrypt(cipher_text);
 }
 
-uint8_t AES::sbox_inverse_substitute(uint8_t in)
+void Cipher::decrypt(ConstByteSlice cipher_text, ByteSlice plain_text)
 {
-	return invertex_sbox[sbox_get_row(in)][sbox_get_column(in)];
+	if (plain_text.size() != cipher_text.size())
+	{
+		throw std::invalid_argument("Output size does not match input size");
+	}
+
+	std::copy(cipher_text.begin(), cipher_text.end(), plain_text.begin());
+	decrypt(plain_text);
 }
 
-uint8_t AES::sbox_get_column(uint8_t in)
+uint8_t AES::sbox_substitute(uint8_t in)
 {
-	return in & 0x0F;
+	return sbox[in];
 }
 
-uint8_t AES::sbox_get_row(uint8_t in)
+uint8_t AES::sbox_inverse_substitute(uint8_t in)
 {
-	return (in & 0xF0) >> 4;
+	return inverse_sbox[in];
 }
 
-void AES::KeySchedule::set_key(std::vector<uint8_t> in_key)
+void AES::KeySchedule::set_key(const std::vector<uint8_t>& in_key)
 {
-	key = std::move(in_key);
-	derive_key_schedule();
+	set_key(in_key.data(), in_key.size());
 }
 
-std::vector<uint8_t>::const_iterator AES::KeySchedule::get_round_key(int round)
+void AES::KeySchedule::set_key(const uint8_t* in_key, std::size_t len)
 {
-	if (round >= rounds)
-	{
-		throw std::invalid_argument("Invalid round");
-	}
+	rounds = get_nr_rounds(len);
+	derive_key_schedule(in_key, static_cast<int>(len) / word_size);
+}
 
-	return expanded_keys.cbegin() + round * block_size;
+// For engines that expand the key themselves; the decryption keys are taken
+// as given so that no table lookups depend on the key.
+void AES::KeySchedule::set_round_keys(const uint8_t* round_keys, const uint8_t* in_decryption_keys, int in_rounds)
+{
+	rounds = in_rounds;
+	std::copy(round_keys, round_keys + rounds * block_size, expanded_keys.begin());
+	std::copy(in_decryption_keys, in_decryption_keys + rounds * block_size, decryption_keys.begin());
 }
 
-std::vector<uint8_t>::const_iterator AES::KeySchedule::get_expanded_key_word(int i)
+uint8_t* AES::KeySchedule::get_expanded_key_word(int i)
 {
-	return expanded_keys.cbegin() + i * word_size;
+	return expanded_keys.data() + i * word_size;
 }
 
-void AES::KeySchedule::derive_key_schedule()
+void AES::KeySchedule::derive_key_schedule(const uint8_t* key, int N)
 {
-	rounds = get_nr_rounds(key.size());
-	int N = key.size() / word_size;
-	expanded_keys.resize(rounds * block_size);
+	std::copy(key, key + N * word_size, expanded_keys.begin());
 
-	for (int i = 0; i < rounds * word_size; i++)
+	for (int i = N; i < rounds * word_size; i++)
 	{
-		auto word_i = expanded_keys.begin() + i * word_size;
-		if (i < N)
-		{
-			std::copy(key.begin() + i * word_size, key.begin() + i * word_size + word_size, word_i);
-		}
-		else if ((i >= N) && (i % N == 0))
-		{
-			auto word_i_N = get_expanded_key_word(i - N);
-			auto word_i_prev = get_expanded_key_word(i - 1);
-			auto round_cnst = get_roundc(i / N);
+		uint8_t* word_i = get_expanded_key_word(i);
+		const uint8_t* word_i_N = get_expanded_key_word(i - N);
+		const uint8_t* word_i_prev = get_expanded_key_word(i - 1);
 
+		if (i % N == 0)
+		{
 			auto word_perm = substitute_word(word_i_prev);
-			substitute_word(word_perm.begin());
-			rotate_word(word_perm.begin());
-			xor_word(word_i, word_perm.begin(), round_cnst.begin());
-			xor_word(word_i, word_i, word_i_N);
+			rotate_word(word_perm.data());
+			word_perm[0] ^= round_constants[i / N - 1];
+			xor_word(word_i, word_perm.data(), word_i_N);
 		}
-		else if ((i >= N) && (N > 6) && (i % N == 4))
+		else if ((N > 6) && (i % N == 4))
 		{
-			auto word_i_N = get_expanded_key_word(i - N);
-			auto word_i_prev = get_expanded_key_word(i - 1);
-
 			auto word_perm = substitute_word(word_i_prev);
-			xor_word(word_i, word_i_N, word_perm.begin());
+			xor_word(word_i, word_i_N, word_perm.data());
 		}
 		else
 		{
-			auto word_i_N = get_expanded_key_word(i - N);
-			auto word_i_prev = get_expanded_key_word(i - 1);
-
 			xor_word(word_i, word_i_N, word_i_prev);
 		}
 	}
+
+	derive_decryption_keys();
 }
 
-template<class iter>
-AES::word AES::KeySchedule::substitute_word(iter to_substitute)
+void AES::KeySchedule::derive_decryption_keys()
 {
-	word out;
-	for (int i = 0; i < word_size; i++)
+	int nr = rounds - 1;
+	for (int round = 0; round <= nr; ++round)
 	{
-		out[i] = AES::sbox_substitute(to_substitute[i]);
-	}
+		const uint8_t* rkey = get_round_key(nr - round);
+		uint8_t* dkey = decryption_keys.data() + round * block_size;
 
-	return out;
+		std::copy(rkey, rkey + block_size, dkey);
+		if (round != 0 && round != nr)
+		{
+			AES::inverse_mix_columns(dkey);
+		}
+	}
 }
 
-template<class iter>
-void AES::KeySchedule::rotate_word(iter to_rotate)
+AES::word AES::KeySchedule::substitute_word(const uint8_t* to_substitute)
 {
-	word tmp;
-
+	word out;
 	for (int i = 0; i < word_size; i++)
 	{
-		tmp[i] = to_rotate[i];
+		out[i] = AES::sbox_substitute(to_substitute[i]);
 	}
 
-
-	to_rotate[0] = tmp[1];
-	to_rotate[1] = tmp[2];
-	to_rotate[2] = tmp[3];
-	to_rotate[3] = tmp[0];
-
+	return out;
 }
 
-AES::word AES::KeySchedule::get_roundc(unsigned int i)
+void AES::KeySchedule::rotate_word(uint8_t* to_rotate)
 {
-	if (round_constants.size() >= i)
-	{
-		return { round_constants[i - 1], 0x00, 0x00, 0x00 };
-	}
-
-	for (std::size_t j = round_constants.size() + 1; j <= i; ++j)
-	{
-		uint8_t rc_j;
-		uint8_t rc_prev = round_constants[j - 2];
-
-		if (rc_prev < 0x80)
-		{
-			rc_j = 2 * rc_prev;
-		}
-		else
-		{
-			rc_j = static_cast<uint8_t>((2 * rc_prev) | 0x11B);
-		}
-
-		round_constants.push_back(rc_j);
-	}
-
-	return { round_constants[i - 1], 0x00, 0x00, 0x00 };
+	std::rotate(to_rotate, to_rotate + 1, to_rotate + word_size);
 }
 
-template<class iter_out, class iter_in1, class iter_in2>
-void AES::KeySchedule::xor_word(iter_out out, iter_in1 in1, iter_in2 in2)
+void AES::KeySchedule::xor_word(uint8_t* out, const uint8_t* in1, const uint8_t* in2)
 {
 	for (int i = 0; i < word_size; i++)
 	{
@@ -170,37 +174,86 @@ int AES::get_nr_rounds(std::size_t length)
 	}
 }
 
+std::unique_ptr<AES> AES::create(AESImplementation implementation)
+{
+	switch (implementation)
+	{
+	case AESImplementation::automatic:
+		if (AESNI::is_supported())
+		{
+			return std::make_unique<AESNI>();
+		}
+		if (AESVectorPermute::is_supported())
+		{
+			return std::make_unique<AESVectorPermute>();
+		}
+		return std::make_unique<AESTable>();
+	case AESImplementation::reference:
+		return std::make_unique<AES>();
+	case AESImplementation::table:
+		return std::make_unique<AESTable>();
+	case AESImplementation::aesni:
+		if (AESNI::is_supported())
+		{
+			return std::make_unique<AESNI>();
+		}
+		return std::make_unique<AES>();
+	case AESImplementation::vector_permute:
+		if (AESVectorPermute::is_supported())
+		{
+			return std::make_unique<AESVectorPermute>();
+		}
+		return std::make_unique<AES>();
+	default:
+		throw std::invalid_argument("Invalid AES implementation");
+	}
+}
+
 void AES::set_key(std::vector<uint8_t> key)
 {
-	rounds = get_nr_rounds(key.size());
-	schedule.set_key(std::move(key));
+	set_key(key.data(), key.size());
+}
+
+void AES::set_key(const uint8_t* key, std::size_t len)
+{
+	schedule.set_key(key, len);
+	set_schedule(schedule);
+}
+
+void AES::set_schedule(const KeySchedule& in_schedule)
+{
+	if (&in_schedule != &schedule)
+	{
+		schedule = in_schedule;
+	}
+	rounds = schedule.get_rounds();
 }
 
 std::vector<uint8_t> AES::encrypt(std::vector<uint8_t> plain_text)
 {
-	if (plain_text.size() % block_size != 0)
+	encrypt(ByteSlice(plain_text.data(), plain_text.size()));
+	return plain_text;
+}
+
+void AES::encrypt(ByteSlice data)
+{
+	if (data.size() % block_size != 0)
 	{
 		throw std::invalid_argument("Invalid block length");
 	}
 
+	encrypt_blocks(data.data(), data.size() / block_size);
+}
 
-	std::vector<uint8_t> cipher_text(plain_text.size());
-	int blocks = plain_text.size() / block_size;
-
-	for (int block_ind = 0; block_ind < blocks; ++block_ind)
+void AES::encrypt_blocks(uint8_t* blocks, std::size_t count)
+{
+	for (std::size_t block_ind = 0; block_ind < count; ++block_ind)
 	{
-		auto block = cipher_text.begin() + block_ind * block_size;
-		std::copy(plain_text.begin() + block_ind * block_size,
-			plain_text.begin() + block_ind * block_size + block_size,
-			block);
-
-		encrypt_block(block);
+		encrypt_block(blocks + block_ind * block_size);
 	}
-
-	return cipher_text;
 }
 
-void AES::encrypt_block(std::vector<uint8_t>::iterator block)
+void AES::encrypt_block(uint8_t* block)
 {
 	auto rkey = schedule.get_round_key(0);
 	add_key(block, rkey);
@@ -220,7 +273,7 @@ void AES::encrypt_block(std::vector<uint8_t>::iterator block)
 	add_key(block, rkey);
 }
 
-void AES::add_key(std::vector<uint8_t>::iterator block, std::vector<uint8_t>::const_iterator key)
+void AES::add_key(uint8_t* block, const uint8_t* key)
 {
 	for (int i = 0; i < block_size; i++)
 	{
@@ -228,7 +281,7 @@ void AES::add_key(std::vector<uint8_t>::iterator block, std::vector<uint8_t>::co
 	}
 }
 
-void AES::sub_bytes(std::vector<uint8_t>::iterator block)
+void AES::sub_bytes(uint8_t* block)
 {
 	for (int i = 0; i < block_size; i++)
 	{
@@ -236,7 +289,7 @@ void AES::sub_bytes(std::vector<uint8_t>::iterator block)
 	}
 }
 
-void AES::shift_rows(std::vector<uint8_t>::iterator block)
+void AES::shift_rows(uint8_t* block)
 {
 	for (int i = 1; i < word_size; i++)
 	{
@@ -254,96 +307,20 @@ void AES::shift_rows(std::vector<uint8_t>::iterator block)
 	}
 }
 
-void AES::mix_columns(std::vector<uint8_t>::iterator block)
+void AES::mix_columns(uint8_t* block)
 {
-	state mixed;
-	static std::array<std::array<uint8_t, 4>, 4> mat = { {
-		{ 0x2, 0x3, 0x1, 0x1 },
-		{ 0x1, 0x2, 0x3, 0x1 },
-		{ 0x1, 0x1, 0x2, 0x3 },
-		{ 0x3, 0x1, 0x1, 0x2 } 
-		} };
+	const auto& m = mul_tables;
 
 	for (int i = 0; i < 4; i++)
 	{
-		for (int j = 0; j < 4; j++)
-		{
-			mixed[get_index(i, j)] =
-				mul(block[get_index(i, 0)], mat[j][0]) ^
-				mul(block[get_index(i, 1)], mat[j][1]) ^
-				mul(block[get_index(i, 2)], mat[j][2]) ^
-				mul(block[get_index(i, 3)], mat[j][3]);
-		}
-	}
+		uint8_t* column = block + get_index(i, 0);
+		uint8_t a0 = column[0], a1 = column[1], a2 = column[2], a3 = column[3];
 
-	std::copy(mixed.begin(), mixed.end(), block);
-}
-
-uint8_t AES::mul(uint8_t in, uint8_t mul)
-{
-	switch (mul)
-	{
-	case 1:
-		return mul1(in);
-	case 2:
-		return mul2(in);
-	case 3:
-		return mul3(in);
-	case 9:
-		return mul9(in);
-	case 11:
-		return mul11(in);
-	case 13:
-		return mul13(in);
-	case 14:
-		return mul14(in);
-	default:
-		throw std::invalid_argument("Invalid multiplicator");
+		column[0] = m.mul2[a0] ^ m.mul3[a1] ^ a2 ^ a3;
+		column[1] = a0 ^ m.mul2[a1] ^ m.mul3[a2] ^ a3;
+		column[2] = a0 ^ a1 ^ m.mul2[a2] ^ m.mul3[a3];
+		column[3] = m.mul3[a0] ^ a1 ^ a2 ^ m.mul2[a3];
 	}
-
-	return 0;
-}
-
-uint8_t AES::mul1(uint8_t in)
-{
-	return in;
-}
-
-uint8_t AES::mul2(uint8_t in)
-{
-	uint8_t out = in << 1;
-
-	if (in & 0x80)
-	{
-		out ^= 0x1b;
-	}
-
-	return out;
-}
-
-uint8_t AES::mul3(uint8_t in)
-{
-	return mul2(in) ^ in;
-}
-
-uint8_t AES::mul9(uint8_t in)
-{
-	return mul2(mul2(mul2(in))) ^ in;
-}
-
-uint8_t AES::mul11(uint8_t in)
-{
-	return mul2(mul2(mul2(in)) ^ in) ^ in;
-}
-
-uint8_t  AES::mul13(uint8_t in)
-{
-	return mul2(mul2(mul2(in) ^ in)) ^ in;
-}
-
-uint8_t  AES::mul14(uint8_t in)
-{
-	return mul2(mul2(mul2(in) ^ in) ^ in);
 }
 
 int AES::get_index(int i, int j)
@@ -353,48 +330,49 @@ int AES::get_index(int i, int j)
 
 std::vector<uint8_t> AES::decrypt(std::vector<uint8_t> cipher_text)
 {
-	if (cipher_text.size() % block_size != 0)
+	decrypt(ByteSlice(cipher_text.data(), cipher_text.size()));
+	return cipher_text;
+}
+
+void AES::decrypt(ByteSlice data)
+{
+	if (data.size() % block_size != 0)
 	{
 		throw std::invalid_argument("Invalid block length");
 	}
 
-	std::vector<uint8_t> plain_text(cipher_text.size());
-	int blocks = cipher_text.size() / block_size;
+	decrypt_blocks(data.data(), data.size() / block_size);
+}
 
-	for (int block_ind = 0; block_ind < blocks; ++block_ind)
+void AES::decrypt_blocks(uint8_t* blocks, std::size_t count)
+{
+	for (std::size_t block_ind = 0; block_ind < count; ++block_ind)
 	{
-		auto block = plain_text.begin() + block_ind * block_size;
-		std::copy(cipher_text.begin() + block_ind * block_size,
-					cipher_text.begin() + block_ind * block_size + block_size,
-					block);
-
-		decrypt_block(block);
+		decrypt_block(blocks + block_ind * block_size);
 	}
-
-	return plain_text;
 }
 
-void AES::decrypt_block(std::vector<uint8_t>::iterator block)
+void AES::decrypt_block(uint8_t* block)
 {
-	auto rkey = schedule.get_round_key(rounds - 1);
+	auto rkey = schedule.get_decryption_round_key(0);
 	add_key(block, rkey);
-	inverse_shift_rows(block);
-	inverse_sub_bytes(block);
 
-	for(int i = rounds-2; i > 0; --i)
+	for (int i = 1; i < rounds - 1; ++i)
 	{
-		rkey = schedule.get_round_key(i);
-		add_key(block, rkey);
-		inverse_mix_columns(block);
-		inverse_shift_rows(block);
 		inverse_sub_bytes(block);
+		inverse_shift_rows(block);
+		inverse_mix_columns(block);
+		rkey = schedule.get_decryption_round_key(i);
+		add_key(block, rkey);
 	}
 
-	rkey = schedule.get_round_key(0);
+	inverse_sub_bytes(block);
+	inverse_shift_rows(block);
+	rkey = schedule.get_decryption_round_key(rounds - 1);
 	add_key(block, rkey);
 }
 
-void AES::inverse_sub_bytes(std::vector<uint8_t>::iterator block)
+void AES::inverse_sub_bytes(uint8_t* block)
 {
 	for (int i = 0; i < block_size; i++)
 	{
@@ -402,7 +380,7 @@ void AES::inverse_sub_bytes(std::vector<uint8_t>::iterator block)
 	}
 }
 
-void AES::inverse_shift_rows(std::vector<uint8_t>::iterator block)
+void AES::inverse_shift_rows(uint8_t* block)
 {
 	for (int i = 1; i < word_size; i++)
 	{
@@ -420,27 +398,18 @@ void AES::inverse_shift_rows(std::vector<uint8_t>::iterator block)
 	}
 }
 
-void AES::inverse_mix_columns(std::vector<uint8_t>::iterator block)
+void AES::inverse_mix_columns(uint8_t* block)
 {
-	state mixed;
-	static std::array<std::array<uint8_t, 4>, 4> mat = { {
-		{ 0xE, 0xB, 0xD, 0x9 },
-		{ 0x9, 0xE, 0xB, 0xD },
-		{ 0xD, 0x9, 0xE, 0xB },
-		{ 0xB, 0xD, 0x9, 0xE }
-		} };
+	const auto& m = mul_tables;
 
 	for (int i = 0; i < 4; i++)
 	{
-		for (int j = 0; j < 4; j++)
-		{
-			mixed[get_index(i, j)] =
-				mul(block[get_index(i, 0)], mat[j][0]) ^
-				mul(block[get_index(i, 1)], mat[j][1]) ^
-				mul(block[get_index(i, 2)], mat[j][2]) ^
-				mul(block[get_index(i, 3)], mat[j][3]);
-		}
+		uint8_t* column = block + get_index(i, 0);
+		uint8_t a0 = column[0], a1 = column[1], a2 = column[2], a3 = column[3];
+
+		column[0] = m.mul14[a0] ^ m.mul11[a1] ^ m.mul13[a2] ^ m.mul9[a3];
+		column[1] = m.mul9[a0] ^ m.mul14[a1] ^ m.mul11[a2] ^ m.mul13[a3];
+		column[2] = m.mul13[a0] ^ m.mul9[a1] ^ m.mul14[a2] ^ m.mul11[a3];
+		column[3] = m.mul11[a0] ^ m.mul13[a1] ^ m.mul9[a2] ^ m.mul14[a3];
 	}
-	std::copy(mixed.begin(), mixed.end(), block);
 }
-
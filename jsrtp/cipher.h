@@ -4,6 +4,9 @@
 #include<cstdint>
 #include<array>
 #include<vector>
+#include<memory>
+#include "container_slice.h"
+#include "aes_field.h"
 
 class Cipher
 {
@@ -11,9 +14,22 @@ public:
 	virtual void set_key(std::vector<uint8_t> key) = 0;
 	virtual std::vector<uint8_t> encrypt(std::vector<uint8_t> plain_text) = 0;
 	virtual std::vector<uint8_t> decrypt(std::vector<uint8_t> cipher_text) = 0;
+	virtual void encrypt(ByteSlice data) = 0;
+	virtual void decrypt(ByteSlice data) = 0;
+	virtual void encrypt(ConstByteSlice plain_text, ByteSlice cipher_text);
+	virtual void decrypt(ConstByteSlice cipher_text, ByteSlice plain_text);
 	virtual ~Cipher() {}
 };
 
+enum class AESImplementation
+{
+	automatic,
+	reference,
+	table,
+	aesni,
+	vector_permute
+};
+
 class AES : public Cipher
 {
 public:
@@ -24,8 +40,16 @@ public:
 	using state = std::array<uint8_t, block_size>;
 
 	virtual void set_key(std::vector<uint8_t> key);
+	virtual void set_key(const uint8_t* key, std::size_t len);
 	virtual std::vector<uint8_t> encrypt(std::vector<uint8_t> plain_text);
 	virtual std::vector<uint8_t> decrypt(std::vector<uint8_t> cipher_text);
+	virtual void encrypt(ByteSlice data);
+	virtual void decrypt(ByteSlice data);
+	using Cipher::encrypt;
+	using Cipher::decrypt;
+
+	virtual void encrypt_blocks(uint8_t* blocks, std::size_t count);
+	virtual void decrypt_blocks(uint8_t* blocks, std::size_t count);
 
 	static uint8_t sbox_substitute(uint8_t in);
 	static uint8_t sbox_inverse_substitute(uint8_t in);
@@ -34,98 +58,73 @@ public:
 	class KeySchedule
 	{
 	public:
-		void set_key(std::vector<uint8_t> in_key);
-		std::vector<uint8_t>::const_iterator get_round_key(int round);
-	private:
-		int rounds = 0;
-		std::vector<uint8_t> round_constants = { 0x1 };
-		std::vector<uint8_t> expanded_keys;
-		std::vector<uint8_t> key;
+		constexpr static int max_round_keys = 15;
 
-		void derive_key_schedule();
-		word get_roundc(unsigned int i);
+		void set_key(const std::vector<uint8_t>& in_key);
+		void set_key(const uint8_t* in_key, std::size_t len);
+		void set_round_keys(const uint8_t* round_keys, const uint8_t* in_decryption_keys, int in_rounds);
+
+		const uint8_t* get_round_key(int round) const
+		{
+			return expanded_keys.data() + round * block_size;
+		}
+
+		const uint8_t* get_decryption_round_key(int round) const
+		{
+			return decryption_keys.data() + round * block_size;
+		}
+
+		int get_rounds() const
+		{
+			return rounds;
+		}
+
+	private:
+		constexpr static std::array<uint8_t, 10> round_constants = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36 };
 
-		template<class iter>
-		word substitute_word(iter to_substitute);
+		int rounds = 0;
+		alignas(16) std::array<uint8_t, max_round_keys * block_size> expanded_keys = {};
+		alignas(16) std::array<uint8_t, max_round_keys * block_size> decryption_keys = {};
 
-		template<class iter>
-		void rotate_word(iter to_rotate);
+		void derive_key_schedule(const uint8_t* key, int key_words);
+		void derive_decryption_keys();
 
-		template<class iter_out, class iter_in1, class iter_in2>
-		void xor_word(iter_out out, iter_in1 in1, iter_in2 in2);
+		word substitute_word(const uint8_t* to_substitute);
+		void rotate_word(uint8_t* to_rotate);
+		void xor_word(uint8_t* out, const uint8_t* in1, const uint8_t* in2);
 
-		std::vector<uint8_t>::const_iterator get_expanded_key_word(int i);
+		uint8_t* get_expanded_key_word(int i);
 	};
 
 	KeySchedule schedule;
 
-private:
+	virtual void set_schedule(const KeySchedule& in_schedule);
+
+	static std::unique_ptr<AES> create(AESImplementation implementation);
+
+protected:
 	int rounds = 0;
-	int get_index(int i, int j);
-
-	void encrypt_block(std::vector<uint8_t>::iterator block);
-	void add_key(std::vector<uint8_t>::iterator block, std::vector<uint8_t>::const_iterator key);
-	void sub_bytes(std::vector<uint8_t>::iterator block);
-	void shift_rows(std::vector<uint8_t>::iterator block);
-	void mix_columns(std::vector<uint8_t>::iterator block);
-
-
-	void decrypt_block(std::vector<uint8_t>::iterator block);
-	void inverse_sub_bytes(std::vector<uint8_t>::iterator block);
-	void inverse_shift_rows(std::vector<uint8_t>::iterator block);
-	void inverse_mix_columns(std::vector<uint8_t>::iterator block);
-
-
-	uint8_t mul(uint8_t in, uint8_t mul);
-	uint8_t mul1(uint8_t in);
-	uint8_t mul2(uint8_t in);
-	uint8_t mul3(uint8_t in);
-
-	uint8_t mul9(uint8_t in);
-	uint8_t mul11(uint8_t in);
-	uint8_t mul13(uint8_t in);
-	uint8_t mul14(uint8_t in);
-
-	constexpr static std::array<std::array<uint8_t, 16>, 16> sbox = { {
-		{0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76},
-		{0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0},
-		{0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15},
-		{0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75},
-		{0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84},
-		{0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf},
-		{0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8},
-		{0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2},
-		{0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73},
-		{0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb},
-		{0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79},
-		{0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08},
-		{0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a},
-		{0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e},
-		{0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf},
-		{0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16}
-	} };
-
-	constexpr static std::array<std::array<uint8_t, 16>, 16> invertex_sbox = { {
-		{0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38, 0xbf, 0x40, 0xa3, 0x9e, 0x81, 0xf3, 0xd7, 0xfb},
-		{0x7c, 0xe3, 0x39, 0x82, 0x9b, 0x2f, 0xff, 0x87, 0x34, 0x8e, 0x43, 0x44, 0xc4, 0xde, 0xe9, 0xcb},
-		{0x54, 0x7b, 0x94, 0x32, 0xa6, 0xc2, 0x23, 0x3d, 0xee, 0x4c, 0x95, 0x0b, 0x42, 0xfa, 0xc3, 0x4e},
-		{0x08, 0x2e, 0xa1, 0x66, 0x28, 0xd9, 0x24, 0xb2, 0x76, 0x5b, 0xa2, 0x49, 0x6d, 0x8b, 0xd1, 0x25},
-		{0x72, 0xf8, 0xf6, 0x64, 0x86, 0x68, 0x98, 0x16, 0xd4, 0xa4, 0x5c, 0xcc, 0x5d, 0x65, 0xb6, 0x92},
-		{0x6c, 0x70, 0x48, 0x50, 0xfd, 0xed, 0xb9, 0xda, 0x5e, 0x15, 0x46, 0x57, 0xa7, 0x8d, 0x9d, 0x84},
-		{0x90, 0xd8, 0xab, 0x00, 0x8c, 0xbc, 0xd3, 0x0a, 0xf7, 0xe4, 0x58, 0x05, 0xb8, 0xb3, 0x45, 0x06},
-		{0xd0, 0x2c, 0x1e, 0x8f, 0xca, 0x3f, 0x0f, 0x02, 0xc1, 0xaf, 0xbd, 0x03, 0x01, 0x13, 0x8a, 0x6b},
-		{0x3a, 0x91, 0x11, 0x41, 0x4f, 0x67, 0xdc, 0xea, 0x97, 0xf2, 0xcf, 0xce, 0xf0, 0xb4, 0xe6, 0x73},
-		{0x96, 0xac, 0x74, 0x22, 0xe7, 0xad, 0x35, 0x85, 0xe2, 0xf9, 0x37, 0xe8, 0x1c, 0x75, 0xdf, 0x6e},
-		{0x47, 0xf1, 0x1a, 0x71, 0x1d, 0x29, 0xc5, 0x89, 0x6f, 0xb7, 0x62, 0x0e, 0xaa, 0x18, 0xbe, 0x1b},
-		{0xfc, 0x56, 0x3e, 0x4b, 0xc6, 0xd2, 0x79, 0x20, 0x9a, 0xdb, 0xc0, 0xfe, 0x78, 0xcd, 0x5a, 0xf4},
-		{0x1f, 0xdd, 0xa8, 0x33, 0x88, 0x07, 0xc7, 0x31, 0xb1, 0x12, 0x10, 0x59, 0x27, 0x80, 0xec, 0x5f},
-		{0x60, 0x51, 0x7f, 0xa9, 0x19, 0xb5, 0x4a, 0x0d, 0x2d, 0xe5, 0x7a, 0x9f, 0x93, 0xc9, 0x9c, 0xef},
-		{0xa0, 0xe0, 0x3b, 0x4d, 0xae, 0x2a, 0xf5, 0xb0, 0xc8, 0xeb, 0xbb, 0x3c, 0x83, 0x53, 0x99, 0x61},
-		{0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26, 0xe1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0c, 0x7d}
-	} };
-
-	static uint8_t sbox_get_column(uint8_t in);
-	static uint8_t sbox_get_row(uint8_t in);
+
+	constexpr static AESField::table sbox = AESField::make_sbox();
+	constexpr static AESField::table inverse_sbox = AESField::make_inverse_sbox();
+
+	template<int KeyBits>
+	friend class AESFixed;
+
+private:
+	static int get_index(int i, int j);
+
+	void encrypt_block(uint8_t* block);
+	void add_key(uint8_t* block, const uint8_t* key);
+	void sub_bytes(uint8_t* block);
+	void shift_rows(uint8_t* block);
+	static void mix_columns(uint8_t* block);
+
+
+	void decrypt_block(uint8_t* block);
+	void inverse_sub_bytes(uint8_t* block);
+	void inverse_shift_rows(uint8_t* block);
+	static void inverse_mix_columns(uint8_t* block);
 };
 
 
@@ -1,31 +1,65 @@
 #ifndef __ContainerSLICE_H__
 #define __ContainerSLICE_H__
 
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+
+template<class Container>
+struct ContainerSliceTraits
+{
+	using iterator = typename Container::iterator;
+	using size_type = typename Container::size_type;
+};
+
+template<class T>
+struct ContainerSliceTraits<T*>
+{
+	using iterator = T*;
+	using size_type = std::size_t;
+};
+
 template<class Container>
 class ContainerSlice
 {
 public:
-	ContainerSlice(typename Container::iterator begin, typename Container::iterator end);
+	using iterator = typename ContainerSliceTraits<Container>::iterator;
+	using size_type = typename ContainerSliceTraits<Container>::size_type;
+
+	ContainerSlice(iterator begin, iterator end);
+	ContainerSlice(iterator begin, size_type size);
 	ContainerSlice() = default;
 
 	auto size();
 	auto begin();
 	auto end();
-	decltype(auto) operator[](typename Container::size_type idx);
+	auto data();
+	decltype(auto) operator[](size_type idx);
 private:
-	typename Container::iterator _begin;
-	typename Container::iterator _end;
-	typename std::iterator_traits<typename Container::iterator>::difference_type _size;
+	iterator _begin = {};
+	iterator _end = {};
+	typename std::iterator_traits<iterator>::difference_type _size = 0;
 };
 
+using ByteSlice = ContainerSlice<uint8_t*>;
+using ConstByteSlice = ContainerSlice<const uint8_t*>;
+
 template<class Container>
-ContainerSlice<Container>::ContainerSlice(typename Container::iterator begin, typename Container::iterator end)
+ContainerSlice<Container>::ContainerSlice(iterator begin, iterator end)
 {
 	_begin = begin;
 	_end = end;
 	_size = std::distance(begin, end);
 }
 
+template<class Container>
+ContainerSlice<Container>::ContainerSlice(iterator begin, size_type size)
+{
+	_begin = begin;
+	_end = begin + size;
+	_size = size;
+}
+
 template<class Container>
 auto ContainerSlice<Container>::size()
 {
@@ -45,8 +79,14 @@ auto ContainerSlice<Container>::end()
 }
 
 template<class Container>
-decltype(auto) ContainerSlice<Container>::operator[](typename Container::size_type idx)
+auto ContainerSlice<Container>::data()
+{
+	return _size > 0 ? &*_begin : nullptr;
+}
+
+template<class Container>
+decltype(auto) ContainerSlice<Container>::operator[](size_type idx)
 {
 	return *(_begin + idx);
 }
-#endif
\ No newline at end of file
+#endif
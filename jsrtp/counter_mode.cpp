@@ -0,0 +1,146 @@
+#include "counter_mode.h"
+#include <algorithm>
+
+AESCounterMode::AESCounterMode() : aes(AES::create(AESImplementation::automatic)) {}
+
+AESCounterMode::AESCounterMode(std::unique_ptr<AES> in_aes) : aes(std::move(in_aes)) {}
+
+void AESCounterMode::set_key(std::vector<uint8_t> key)
+{
+	set_key(key.data(), key.size());
+}
+
+void AESCounterMode::set_key(const uint8_t* key, std::size_t len)
+{
+	aes->set_key(key, len);
+	keystream_used = keystream_len = 0;
+}
+
+void AESCounterMode::set_iv(const uint8_t* iv)
+{
+	std::copy(iv, iv + AES::block_size, counter.begin());
+	keystream_used = keystream_len = 0;
+}
+
+void AESCounterMode::set_iv(const AES::state& iv)
+{
+	set_iv(iv.data());
+}
+
+void AESCounterMode::apply_keystream(std::vector<uint8_t>& data)
+{
+	apply_keystream(data.data(), data.size());
+}
+
+void AESCounterMode::apply_keystream(ByteSlice data)
+{
+	apply_keystream(data.data(), data.size());
+}
+
+void AESCounterMode::apply_keystream(uint8_t* data, std::size_t len)
+{
+	std::size_t leftover = std::min(len, keystream_len - keystream_used);
+	for (std::size_t i = 0; i < leftover; ++i)
+	{
+		data[i] ^= keystream[keystream_used + i];
+	}
+	keystream_used += leftover;
+	data += leftover;
+	len -= leftover;
+
+	while (len >= batch_size)
+	{
+		generate_keystream(batch_blocks);
+		for (std::size_t i = 0; i < batch_size; ++i)
+		{
+			data[i] ^= keystream[i];
+		}
+		keystream_used = batch_size;
+		data += batch_size;
+		len -= batch_size;
+	}
+
+	if (len > 0)
+	{
+		generate_keystream((len + AES::block_size - 1) / AES::block_size);
+		for (std::size_t i = 0; i < len; ++i)
+		{
+			data[i] ^= keystream[i];
+		}
+		keystream_used = len;
+	}
+}
+
+void AESCounterMode::generate_keystream(std::size_t blocks)
+{
+	for (std::size_t i = 0; i < blocks; ++i)
+	{
+		std::copy(counter.begin(), counter.end(), keystream.begin() + i * AES::block_size);
+		increment_counter();
+	}
+
+	aes->encrypt_blocks(keystream.data(), blocks);
+	keystream_used = 0;
+	keystream_len = blocks * AES::block_size;
+}
+
+void AESCounterMode::apply_keystreams(const KeystreamRequest* requests, std::size_t count)
+{
+	alignas(16) std::array<uint8_t, batch_size> blocks;
+	std::array<uint8_t*, batch_blocks> targets;
+	std::array<std::size_t, batch_blocks> lengths;
+	std::size_t pending = 0;
+
+	auto flush = [&]()
+	{
+		aes->encrypt_blocks(blocks.data(), pending);
+		for (std::size_t block = 0; block < pending; ++block)
+		{
+			for (std::size_t i = 0; i < lengths[block]; ++i)
+			{
+				targets[block][i] ^= blocks[block * AES::block_size + i];
+			}
+		}
+		pending = 0;
+	};
+
+	for (std::size_t request = 0; request < count; ++request)
+	{
+		AES::state request_counter;
+		std::copy(requests[request].iv, requests[request].iv + AES::block_size, request_counter.begin());
+
+		for (std::size_t offset = 0; offset < requests[request].len; offset += AES::block_size)
+		{
+			std::copy(request_counter.begin(), request_counter.end(), blocks.begin() + pending * AES::block_size);
+			increment_counter(request_counter);
+			targets[pending] = requests[request].data + offset;
+			lengths[pending] = std::min<std::size_t>(AES::block_size, requests[request].len - offset);
+
+			if (++pending == batch_blocks)
+			{
+				flush();
+			}
+		}
+	}
+
+	if (pending > 0)
+	{
+		flush();
+	}
+}
+
+void AESCounterMode::increment_counter()
+{
+	increment_counter(counter);
+}
+
+void AESCounterMode::increment_counter(AES::state& in_counter)
+{
+	for (int i = AES::block_size - 1; i >= 0; --i)
+	{
+		if (++in_counter[i] != 0)
+		{
+			break;
+		}
+	}
+}
@@ -0,0 +1,74 @@
+#ifndef __COUNTER_MODE_H__
+#define __COUNTER_MODE_H__
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <memory>
+#include "cipher.h"
+
+struct KeystreamRequest
+{
+	const uint8_t* iv;
+	uint8_t* data;
+	std::size_t len;
+};
+
+class AESCounterMode
+{
+public:
+	constexpr static int batch_blocks = 8;
+	constexpr static int batch_size = batch_blocks * AES::block_size;
+
+	AESCounterMode();
+	AESCounterMode(std::unique_ptr<AES> in_aes);
+
+	void set_key(std::vector<uint8_t> key);
+	void set_key(const uint8_t* key, std::size_t len);
+	void set_iv(const uint8_t* iv);
+	void set_iv(const AES::state& iv);
+
+	void apply_keystream(uint8_t* data, std::size_t len);
+	void apply_keystream(std::vector<uint8_t>& data);
+	void apply_keystream(ByteSlice data);
+	void apply_keystreams(const KeystreamRequest* requests, std::size_t count);
+
+private:
+	std::unique_ptr<AES> aes;
+	AES::state counter = {};
+	alignas(16) std::array<uint8_t, batch_size> keystream = {};
+	std::size_t keystream_used = 0;
+	std::size_t keystream_len = 0;
+
+	void generate_keystream(std::size_t blocks);
+	void increment_counter();
+	static void increment_counter(AES::state& in_counter);
+};
+
+// Keystream requests of one batch together with the IVs they point at.
+template<std::size_t N>
+class KeystreamBatch
+{
+public:
+	void add(const AES::state& iv, uint8_t* data, std::size_t len)
+	{
+		ivs[count] = iv;
+		requests[count] = { ivs[count].data(), data, len };
+		++count;
+	}
+
+	void apply(AESCounterMode& cipher) const
+	{
+		if (count > 0)
+		{
+			cipher.apply_keystreams(requests.data(), count);
+		}
+	}
+
+private:
+	std::array<AES::state, N> ivs = {};
+	std::array<KeystreamRequest, N> requests = {};
+	std::size_t count = 0;
+};
+
+#endif
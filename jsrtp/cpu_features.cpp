@@ -0,0 +1,73 @@
+#include "cpu_features.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+namespace
+{
+	void cpuid(int leaf, int subleaf, unsigned int regs[4])
+	{
+#if defined(_MSC_VER)
+		int out[4];
+		__cpuidex(out, leaf, subleaf);
+		for (int i = 0; i < 4; ++i)
+		{
+			regs[i] = static_cast<unsigned int>(out[i]);
+		}
+#else
+		__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+	}
+
+	bool os_saves_ymm()
+	{
+#if defined(_MSC_VER)
+		return (_xgetbv(0) & 0x6) == 0x6;
+#else
+		unsigned int eax, edx;
+		__asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return (eax & 0x6) == 0x6;
+#endif
+	}
+}
+
+const CPUFeatures& CPUFeatures::get()
+{
+	static const CPUFeatures features = detect();
+	return features;
+}
+
+CPUFeatures CPUFeatures::detect()
+{
+	CPUFeatures features;
+	unsigned int regs[4];
+
+	cpuid(0, 0, regs);
+	unsigned int max_leaf = regs[0];
+	if (max_leaf < 1)
+	{
+		return features;
+	}
+
+	cpuid(1, 0, regs);
+	unsigned int ecx = regs[2];
+	features.ssse3 = (ecx & (1u << 9)) != 0;
+	features.sse41 = (ecx & (1u << 19)) != 0;
+	features.aesni = (ecx & (1u << 25)) != 0;
+	features.pclmulqdq = (ecx & (1u << 1)) != 0;
+
+	bool avx = (ecx & (1u << 27)) && (ecx & (1u << 28)) && os_saves_ymm();
+
+	if (max_leaf >= 7)
+	{
+		cpuid(7, 0, regs);
+		unsigned int ebx = regs[1];
+		features.avx2 = avx && (ebx & (1u << 5)) != 0;
+		features.sha = (ebx & (1u << 29)) != 0;
+	}
+
+	return features;
+}
@@ -0,0 +1,25 @@
+#ifndef __CPU_FEATURES_H__
+#define __CPU_FEATURES_H__
+
+#if defined(__GNUC__)
+#define JSRTP_TARGET(features) __attribute__((target(features)))
+#else
+#define JSRTP_TARGET(features)
+#endif
+
+struct CPUFeatures
+{
+	bool ssse3 = false;
+	bool sse41 = false;
+	bool aesni = false;
+	bool pclmulqdq = false;
+	bool avx2 = false;
+	bool sha = false;
+
+	static const CPUFeatures& get();
+
+private:
+	static CPUFeatures detect();
+};
+
+#endif
@@ -0,0 +1,233 @@
+#include "gcm.h"
+#include "cpu_features.h"
+#include "byte_order.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+	constexpr std::array<uint64_t, 16> reduction_table = {
+		0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+		0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0
+	};
+}
+
+GHash::GHash(GHashImplementation implementation)
+{
+	switch (implementation)
+	{
+	case GHashImplementation::automatic:
+	case GHashImplementation::clmul:
+		use_clmul = clmul_supported();
+		break;
+	default:
+		use_clmul = false;
+		break;
+	}
+}
+
+bool GHash::clmul_supported()
+{
+	const CPUFeatures& features = CPUFeatures::get();
+	return features.pclmulqdq && features.ssse3;
+}
+
+void GHash::set_key(const uint8_t* h)
+{
+	reset();
+
+	if (use_clmul)
+	{
+		init_clmul(h, powers.data());
+		return;
+	}
+
+	// Shoup's 4-bit tables: entry i holds i * H in GCM bit order.
+	uint64_t high = load_be64(h);
+	uint64_t low = load_be64(h + 8);
+
+	table_high[0] = table_low[0] = 0;
+	table_high[8] = high;
+	table_low[8] = low;
+
+	for (int i = 4; i > 0; i >>= 1)
+	{
+		uint64_t carry = (low & 1) * 0xe100000000000000ULL;
+		low = (high << 63) | (low >> 1);
+		high = (high >> 1) ^ carry;
+		table_high[i] = high;
+		table_low[i] = low;
+	}
+
+	for (int i = 2; i <= 8; i *= 2)
+	{
+		for (int j = 1; j < i; ++j)
+		{
+			table_high[i + j] = table_high[i] ^ table_high[j];
+			table_low[i + j] = table_low[i] ^ table_low[j];
+		}
+	}
+}
+
+void GHash::reset()
+{
+	y.fill(0);
+}
+
+void GHash::update(const uint8_t* data, std::size_t len)
+{
+	std::size_t blocks = len / block_size;
+	update_blocks(data, blocks);
+
+	std::size_t remaining = len - blocks * block_size;
+	if (remaining > 0)
+	{
+		std::array<uint8_t, block_size> last = {};
+		std::copy(data + blocks * block_size, data + len, last.begin());
+		update_blocks(last.data(), 1);
+	}
+}
+
+void GHash::finish(uint64_t aad_len, uint64_t text_len, uint8_t* out)
+{
+	std::array<uint8_t, block_size> lengths;
+	store_be64(aad_len * 8, lengths.data());
+	store_be64(text_len * 8, lengths.data() + 8);
+	update_blocks(lengths.data(), 1);
+
+	std::copy(y.begin(), y.end(), out);
+	reset();
+}
+
+void GHash::update_blocks(const uint8_t* blocks, std::size_t count)
+{
+	if (use_clmul)
+	{
+		update_clmul(y.data(), powers.data(), blocks, count);
+		return;
+	}
+
+	for (; count > 0; --count, blocks += block_size)
+	{
+		for (int i = 0; i < block_size; ++i)
+		{
+			y[i] ^= blocks[i];
+		}
+		multiply_table(y.data());
+	}
+}
+
+void GHash::multiply_table(uint8_t* x) const
+{
+	int nibble = x[15] & 0x0f;
+	uint64_t high = table_high[nibble];
+	uint64_t low = table_low[nibble];
+
+	for (int i = 15; i >= 0; --i)
+	{
+		if (i != 15)
+		{
+			nibble = x[i] & 0x0f;
+			uint64_t rem = low & 0x0f;
+			low = (high << 60) | (low >> 4);
+			high = (high >> 4) ^ (reduction_table[rem] << 48) ^ table_high[nibble];
+			low ^= table_low[nibble];
+		}
+
+		nibble = x[i] >> 4;
+		uint64_t rem = low & 0x0f;
+		low = (high << 60) | (low >> 4);
+		high = (high >> 4) ^ (reduction_table[rem] << 48) ^ table_high[nibble];
+		low ^= table_low[nibble];
+	}
+
+	store_be64(high, x);
+	store_be64(low, x + 8);
+}
+
+AESGCM::AESGCM() : ctr(AES::create(AESImplementation::automatic)) {}
+
+AESGCM::AESGCM(std::unique_ptr<AES> in_aes, GHashImplementation ghash_implementation) : ctr(std::move(in_aes)), ghash(ghash_implementation) {}
+
+void AESGCM::set_key(std::vector<uint8_t> key)
+{
+	set_key(key.data(), key.size());
+}
+
+void AESGCM::set_key(const uint8_t* key, std::size_t len)
+{
+	if (len != 16 && len != 24 && len != 32)
+	{
+		throw std::invalid_argument("Invalid key size");
+	}
+
+	ctr.set_key(key, len);
+
+	AES::state h = {};
+	ctr.set_iv(h);
+	ctr.apply_keystream(h.data(), h.size());
+	ghash.set_key(h.data());
+}
+
+void AESGCM::start(const uint8_t* iv, ConstByteSlice aad, AES::state& tag_mask)
+{
+	AES::state j0 = {};
+	std::copy(iv, iv + iv_size, j0.begin());
+	j0[AES::block_size - 1] = 1;
+
+	tag_mask.fill(0);
+	ctr.set_iv(j0);
+	ctr.apply_keystream(tag_mask.data(), tag_mask.size());
+
+	ghash.reset();
+	ghash.update(aad.data(), aad.size());
+}
+
+void AESGCM::finish(std::size_t aad_len, std::size_t text_len, const AES::state& tag_mask, uint8_t* tag)
+{
+	ghash.finish(aad_len, text_len, tag);
+	for (int i = 0; i < tag_size; ++i)
+	{
+		tag[i] ^= tag_mask[i];
+	}
+}
+
+void AESGCM::encrypt(const uint8_t* iv, ConstByteSlice aad, ByteSlice data, uint8_t* tag)
+{
+	AES::state tag_mask;
+	start(iv, aad, tag_mask);
+
+	std::size_t data_len = static_cast<std::size_t>(data.size());
+	for (std::size_t offset = 0; offset < data_len; offset += chunk_size)
+	{
+		std::size_t len = std::min(chunk_size, data_len - offset);
+		ctr.apply_keystream(data.data() + offset, len);
+		ghash.update(data.data() + offset, len);
+	}
+
+	finish(aad.size(), data_len, tag_mask, tag);
+}
+
+bool AESGCM::decrypt(const uint8_t* iv, ConstByteSlice aad, ByteSlice data, const uint8_t* tag)
+{
+	AES::state tag_mask;
+	start(iv, aad, tag_mask);
+	ghash.update(data.data(), data.size());
+
+	AES::state expected;
+	finish(aad.size(), data.size(), tag_mask, expected.data());
+
+	uint8_t diff = 0;
+	for (int i = 0; i < tag_size; ++i)
+	{
+		diff |= expected[i] ^ tag[i];
+	}
+
+	if (diff != 0)
+	{
+		return false;
+	}
+
+	ctr.apply_keystream(data.data(), data.size());
+	return true;
+}
@@ -0,0 +1,76 @@
+#ifndef __GCM_H__
+#define __GCM_H__
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <memory>
+#include "container_slice.h"
+#include "cipher.h"
+#include "counter_mode.h"
+
+enum class GHashImplementation
+{
+	automatic,
+	table,
+	clmul
+};
+
+class GHash
+{
+public:
+	constexpr static int block_size = 16;
+	constexpr static int aggregate_blocks = 8;
+
+	GHash(GHashImplementation implementation = GHashImplementation::automatic);
+
+	void set_key(const uint8_t* h);
+	void reset();
+
+	// A trailing partial block is zero padded, so only the last update of the
+	// AAD or of the text may have a length that is not a multiple of block_size.
+	void update(const uint8_t* data, std::size_t len);
+	void finish(uint64_t aad_len, uint64_t text_len, uint8_t* out);
+
+	static bool clmul_supported();
+
+private:
+	bool use_clmul;
+	std::array<uint8_t, block_size> y = {};
+	std::array<uint64_t, 16> table_high = {};
+	std::array<uint64_t, 16> table_low = {};
+	alignas(16) std::array<uint8_t, aggregate_blocks * block_size> powers = {};
+
+	void update_blocks(const uint8_t* blocks, std::size_t count);
+	void multiply_table(uint8_t* x) const;
+
+	static void init_clmul(const uint8_t* h, uint8_t* powers);
+	static void update_clmul(uint8_t* y, const uint8_t* powers, const uint8_t* blocks, std::size_t count);
+};
+
+class AESGCM
+{
+public:
+	constexpr static int iv_size = 12;
+	constexpr static int tag_size = 16;
+
+	AESGCM();
+	AESGCM(std::unique_ptr<AES> in_aes, GHashImplementation ghash_implementation = GHashImplementation::automatic);
+
+	void set_key(std::vector<uint8_t> key);
+	void set_key(const uint8_t* key, std::size_t len);
+
+	void encrypt(const uint8_t* iv, ConstByteSlice aad, ByteSlice data, uint8_t* tag);
+	bool decrypt(const uint8_t* iv, ConstByteSlice aad, ByteSlice data, const uint8_t* tag);
+
+private:
+	constexpr static std::size_t chunk_size = AESCounterMode::batch_size;
+
+	AESCounterMode ctr;
+	GHash ghash;
+
+	void start(const uint8_t* iv, ConstByteSlice aad, AES::state& tag_mask);
+	void finish(std::size_t aad_len, std::size_t text_len, const AES::state& tag_mask, uint8_t* tag);
+};
+
+#endif
@@ -0,0 +1,109 @@
+#include "gcm.h"
+#include "cpu_features.h"
+#include <immintrin.h>
+
+namespace
+{
+	// Blocks are byte reversed on load, which leaves GHASH's reflected bit
+	// order one bit off from a plain carry-less product. The product is
+	// shifted left by one before the reduction to account for that.
+	JSRTP_TARGET("ssse3")
+	inline __m128i byte_reverse(__m128i in)
+	{
+		const __m128i mask = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+		return _mm_shuffle_epi8(in, mask);
+	}
+
+	JSRTP_TARGET("pclmul,sse2")
+	inline void multiply_accumulate(__m128i a, __m128i b, __m128i& low, __m128i& middle, __m128i& high)
+	{
+		low = _mm_xor_si128(low, _mm_clmulepi64_si128(a, b, 0x00));
+		high = _mm_xor_si128(high, _mm_clmulepi64_si128(a, b, 0x11));
+		middle = _mm_xor_si128(middle, _mm_clmulepi64_si128(a, b, 0x01));
+		middle = _mm_xor_si128(middle, _mm_clmulepi64_si128(a, b, 0x10));
+	}
+
+	JSRTP_TARGET("sse2")
+	inline __m128i reduce(__m128i low, __m128i middle, __m128i high)
+	{
+		low = _mm_xor_si128(low, _mm_slli_si128(middle, 8));
+		high = _mm_xor_si128(high, _mm_srli_si128(middle, 8));
+
+		__m128i low_carry = _mm_srli_epi32(low, 31);
+		__m128i high_carry = _mm_srli_epi32(high, 31);
+		low = _mm_slli_epi32(low, 1);
+		high = _mm_slli_epi32(high, 1);
+		high = _mm_or_si128(high, _mm_srli_si128(low_carry, 12));
+		high = _mm_or_si128(high, _mm_slli_si128(high_carry, 4));
+		low = _mm_or_si128(low, _mm_slli_si128(low_carry, 4));
+
+		__m128i t = _mm_xor_si128(_mm_xor_si128(_mm_slli_epi32(low, 31), _mm_slli_epi32(low, 30)), _mm_slli_epi32(low, 25));
+		__m128i t_high = _mm_srli_si128(t, 4);
+		low = _mm_xor_si128(low, _mm_slli_si128(t, 12));
+
+		__m128i u = _mm_xor_si128(_mm_xor_si128(_mm_srli_epi32(low, 1), _mm_srli_epi32(low, 2)), _mm_srli_epi32(low, 7));
+		u = _mm_xor_si128(u, t_high);
+		low = _mm_xor_si128(low, u);
+
+		return _mm_xor_si128(high, low);
+	}
+
+	JSRTP_TARGET("pclmul,sse2")
+	inline __m128i multiply(__m128i a, __m128i b)
+	{
+		__m128i low = _mm_setzero_si128();
+		__m128i middle = _mm_setzero_si128();
+		__m128i high = _mm_setzero_si128();
+		multiply_accumulate(a, b, low, middle, high);
+		return reduce(low, middle, high);
+	}
+}
+
+// powers holds H^1 to H^aggregate_blocks, byte reversed.
+JSRTP_TARGET("pclmul,ssse3")
+void GHash::init_clmul(const uint8_t* h, uint8_t* powers)
+{
+	__m128i* out = reinterpret_cast<__m128i*>(powers);
+	__m128i h1 = byte_reverse(_mm_loadu_si128(reinterpret_cast<const __m128i*>(h)));
+	__m128i power = h1;
+
+	_mm_store_si128(out, h1);
+	for (int i = 1; i < aggregate_blocks; ++i)
+	{
+		power = multiply(power, h1);
+		_mm_store_si128(out + i, power);
+	}
+}
+
+// Up to aggregate_blocks blocks are folded in with a single reduction:
+// Y' = (Y ^ X1) * H^n ^ X2 * H^(n-1) ^ ... ^ Xn * H.
+JSRTP_TARGET("pclmul,ssse3")
+void GHash::update_clmul(uint8_t* y, const uint8_t* powers, const uint8_t* blocks, std::size_t count)
+{
+	const __m128i* h = reinterpret_cast<const __m128i*>(powers);
+	const __m128i* in = reinterpret_cast<const __m128i*>(blocks);
+	__m128i state = byte_reverse(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y)));
+
+	while (count > 0)
+	{
+		std::size_t n = count < aggregate_blocks ? count : aggregate_blocks;
+		__m128i low = _mm_setzero_si128();
+		__m128i middle = _mm_setzero_si128();
+		__m128i high = _mm_setzero_si128();
+
+		__m128i x = _mm_xor_si128(state, byte_reverse(_mm_loadu_si128(in)));
+		multiply_accumulate(x, _mm_load_si128(h + n - 1), low, middle, high);
+
+		for (std::size_t i = 1; i < n; ++i)
+		{
+			x = byte_reverse(_mm_loadu_si128(in + i));
+			multiply_accumulate(x, _mm_load_si128(h + n - 1 - i), low, middle, high);
+		}
+
+		state = reduce(low, middle, high);
+		in += n;
+		count -= n;
+	}
+
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(y), byte_reverse(state));
+}
@@ -1,157 +1,459 @@
 #include "hash.h"
 #include <limits>
-#include <numeric>
 #include <iostream>
+#include <algorithm>
+#include <utility>
+#include "cpu_features.h"
 
-void SHA1::append(const uint8_t* in, uint64_t len)
+namespace
 {
-	if (message_len > std::numeric_limits<uint64_t>::max() - (len * 8))
+	template<int bits>
+	inline uint32_t rotate_left(uint32_t in)
+	{
+		return (in << bits) | (in >> (32 - bits));
+	}
+
+	inline uint32_t load_big_endian(const uint8_t* in)
+	{
+		return (static_cast<uint32_t>(in[0]) << 24) | (static_cast<uint32_t>(in[1]) << 16) |
+			(static_cast<uint32_t>(in[2]) << 8) | static_cast<uint32_t>(in[3]);
+	}
+
+	// The five working variables rotate through v[] by index instead of being
+	// moved, and w[] holds the last 16 schedule words.
+	template<int i>
+	inline void sha1_round(uint32_t* v, uint32_t* w, const uint8_t* block)
+	{
+		uint32_t& a = v[(80 - i) % 5];
+		uint32_t& b = v[(81 - i) % 5];
+		uint32_t& c = v[(82 - i) % 5];
+		uint32_t& d = v[(83 - i) % 5];
+		uint32_t& e = v[(84 - i) % 5];
+
+		if constexpr (i < 16)
+		{
+			w[i] = load_big_endian(block + i * 4);
+		}
+		else
+		{
+			w[i & 15] = rotate_left<1>(w[(i + 13) & 15] ^ w[(i + 8) & 15] ^ w[(i + 2) & 15] ^ w[i & 15]);
+		}
+
+		if constexpr (i < 20)
+		{
+			e += ((b & c) | (~b & d)) + 0x5A827999;
+		}
+		else if constexpr (i < 40)
+		{
+			e += (b ^ c ^ d) + 0x6ED9EBA1;
+		}
+		else if constexpr (i < 60)
+		{
+			e += ((b & c) | (d & (b | c))) + 0x8F1BBCDC;
+		}
+		else
+		{
+			e += (b ^ c ^ d) + 0xCA62C1D6;
+		}
+
+		e += rotate_left<5>(a) + w[i & 15];
+		b = rotate_left<30>(b);
+	}
+
+	template<std::size_t... i>
+	inline void sha1_rounds(uint32_t* v, uint32_t* w, const uint8_t* block, std::index_sequence<i...>)
 	{
-		throw std::runtime_error("Message size is too large");
+		(sha1_round<i>(v, w, block), ...);
+	}
+
+	// Merkle-Damgard padding and buffering, shared by SHA1 and SHA256.
+	template<class Hash>
+	void stream_append(typename Hash::state& h, std::array<uint8_t, Hash::BLOCK_SIZE>& buffer, std::size_t& buffer_len, uint64_t& message_len, const uint8_t* in, uint64_t len)
+	{
+		if (message_len > std::numeric_limits<uint64_t>::max() - (len * 8))
+		{
+			throw std::runtime_error("Message size is too large");
+		}
+
+		message_len += len * Hash::BITS_PER_BYTE;
+
+		if (buffer_len > 0)
+		{
+			std::size_t to_copy = std::min<uint64_t>(len, Hash::BLOCK_SIZE - buffer_len);
+			std::copy(in, in + to_copy, buffer.begin() + buffer_len);
+			buffer_len += to_copy;
+			in += to_copy;
+			len -= to_copy;
+
+			if (buffer_len < Hash::BLOCK_SIZE)
+			{
+				return;
+			}
+
+			Hash::compress_blocks(h, buffer.data(), 1);
+			buffer_len = 0;
+		}
+
+		uint64_t blocks = len / Hash::BLOCK_SIZE;
+		Hash::compress_blocks(h, in, static_cast<std::size_t>(blocks));
+		in += blocks * Hash::BLOCK_SIZE;
+		len -= blocks * Hash::BLOCK_SIZE;
+
+		std::copy(in, in + len, buffer.begin());
+		buffer_len = static_cast<std::size_t>(len);
+	}
+
+	template<class Hash>
+	void stream_finalize(typename Hash::state& h, std::array<uint8_t, Hash::BLOCK_SIZE>& buffer, std::size_t buffer_len, uint64_t message_len)
+	{
+		buffer[buffer_len++] = 0x80;
+
+		if (buffer_len > Hash::BLOCK_SIZE - Hash::MESSAGE_LEN_SIZE)
+		{
+			std::fill(buffer.begin() + buffer_len, buffer.end(), 0x0);
+			Hash::compress_blocks(h, buffer.data(), 1);
+			buffer_len = 0;
+		}
+
+		std::fill(buffer.begin() + buffer_len, buffer.end() - Hash::MESSAGE_LEN_SIZE, 0x0);
+		for (int i = 0; i < Hash::MESSAGE_LEN_SIZE; ++i)
+		{
+			buffer[Hash::BLOCK_SIZE - 1 - i] = static_cast<uint8_t>(message_len >> (i * Hash::BITS_PER_BYTE));
+		}
+
+		Hash::compress_blocks(h, buffer.data(), 1);
 	}
 
-	std::copy(in, in + len, std::back_inserter(message));
-	message_len += len * 8;
+	template<int bits>
+	inline uint32_t rotate_right(uint32_t in)
+	{
+		return (in >> bits) | (in << (32 - bits));
+	}
+
+	// Same rotating-index scheme as SHA1: a to h live in v[] and only the
+	// slots of the new a and e are written each round.
+	template<int i>
+	inline void sha256_step(uint32_t* v, uint32_t w_plus_k)
+	{
+		uint32_t& a = v[(64 - i) % 8];
+		uint32_t& b = v[(65 - i) % 8];
+		uint32_t& c = v[(66 - i) % 8];
+		uint32_t& d = v[(67 - i) % 8];
+		uint32_t& e = v[(68 - i) % 8];
+		uint32_t& f = v[(69 - i) % 8];
+		uint32_t& g = v[(70 - i) % 8];
+		uint32_t& h = v[(71 - i) % 8];
+
+		uint32_t t1 = h + (rotate_right<6>(e) ^ rotate_right<11>(e) ^ rotate_right<25>(e)) + ((e & f) ^ (~e & g)) + w_plus_k;
+		uint32_t t2 = (rotate_right<2>(a) ^ rotate_right<13>(a) ^ rotate_right<22>(a)) + ((a & b) ^ (a & c) ^ (b & c));
+		d += t1;
+		h = t1 + t2;
+	}
+
+	template<int i>
+	inline void sha256_round(uint32_t* v, uint32_t* w, const uint8_t* block)
+	{
+		if constexpr (i < 16)
+		{
+			w[i] = load_big_endian(block + i * 4);
+		}
+		else
+		{
+			uint32_t w2 = w[(i + 14) & 15];
+			uint32_t w15 = w[(i + 1) & 15];
+			w[i & 15] += (rotate_right<17>(w2) ^ rotate_right<19>(w2) ^ (w2 >> 10)) + w[(i + 9) & 15] + (rotate_right<7>(w15) ^ rotate_right<18>(w15) ^ (w15 >> 3));
+		}
+
+		sha256_step<i>(v, w[i & 15] + SHA256::ROUND_CONSTANTS[i]);
+	}
+
+	template<std::size_t... i>
+	inline void sha256_rounds(uint32_t* v, uint32_t* w, const uint8_t* block, std::index_sequence<i...>)
+	{
+		(sha256_round<i>(v, w, block), ...);
+	}
+
+	template<std::size_t... i>
+	inline void sha256_scheduled_rounds(uint32_t* v, const uint32_t* schedule, std::size_t stride, std::index_sequence<i...>)
+	{
+		(sha256_step<i>(v, schedule[(i / 4) * stride + i % 4]), ...);
+	}
+}
+
+void HashFunction::append(const HashSegment* segments, std::size_t count)
+{
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		append(segments[i].data, segments[i].len);
+	}
+}
+
+void SHA1::append(const uint8_t* in, uint64_t len)
+{
+	stream_append<SHA1>(h, buffer, buffer_len, message_len, in, len);
+}
+
+void SHA1::append(const HashSegment* segments, std::size_t count)
+{
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		stream_append<SHA1>(h, buffer, buffer_len, message_len, segments[i].data, segments[i].len);
+	}
 }
 
 void SHA1::append(const std::vector<uint8_t>& in)
 {
-	if (message_len > std::numeric_limits<uint64_t>::max() - (static_cast<uint64_t>(in.size()) * 8))
+	append(in.data(), in.size());
+}
+
+void SHA1::append(ConstByteSlice in)
+{
+	append(in.data(), in.size());
+}
+
+void SHA1::finalize()
+{
+	stream_finalize<SHA1>(h, buffer, buffer_len, message_len);
+}
+
+void SHA1::reset()
+{
+	h = INITIAL_STATE;
+	buffer_len = 0;
+	message_len = 0;
+}
+
+void SHA1::compress_blocks(state& h, const uint8_t* blocks, std::size_t count)
+{
+	if (ni_supported())
+	{
+		compress_blocks_ni(h, blocks, count);
+	}
+	else
 	{
-		throw std::runtime_error("Message size is too large");
+		compress_blocks_portable(h, blocks, count);
 	}
+}
 
-	std::copy(in.begin(), in.end(), std::back_inserter(message));
-	message_len += static_cast<uint64_t>(in.size()) * BITS_PER_BYTE;
+bool SHA1::ni_supported()
+{
+	const CPUFeatures& features = CPUFeatures::get();
+	return features.sha && features.sse41;
 }
 
-std::vector<uint8_t> SHA1::preprocess_message()
+void SHA1::compress_blocks_portable(state& h, const uint8_t* blocks, std::size_t count)
 {
-	std::vector<uint8_t> preprocessed(message);
-	preprocessed.push_back(0x80);
+	for (; count > 0; --count, blocks += BLOCK_SIZE)
+	{
+		uint32_t v[5] = { h[0], h[1], h[2], h[3], h[4] };
+		uint32_t w[16];
 
-	int to_pad = (BLOCK_SIZE - ((preprocessed.size() + MESSAGE_LEN_SIZE) % BLOCK_SIZE)) % BLOCK_SIZE;
-	std::fill_n(std::back_inserter(preprocessed), to_pad, 0x0);
-	std::array<uint8_t, 8> len_in;
-	std::memcpy(len_in.data(), &message_len, sizeof(message_len));
-	std::copy(len_in.rbegin(), len_in.rend(), std::back_inserter(preprocessed));
+		sha1_rounds(v, w, blocks, std::make_index_sequence<80>());
 
-	return preprocessed;
+		h[0] += v[0];
+		h[1] += v[1];
+		h[2] += v[2];
+		h[3] += v[3];
+		h[4] += v[4];
+	}
 }
 
-std::array<uint32_t, 80> SHA1::get_words(std::vector<uint8_t>::iterator chunk_start)
+std::vector<uint8_t> SHA1::get_digest()
 {
-	std::array<uint32_t, 80> words;
+	std::vector<uint8_t> digest(DIGEST_SIZE);
+	get_digest(ByteSlice(digest.data(), digest.size()));
+	return digest;
+}
 
-	for (int i = 0; i < 16; ++i)
+void SHA1::get_digest(ByteSlice out)
+{
+	if (out.size() > DIGEST_SIZE)
 	{
-		auto little_endian = [](uint32_t tot, uint8_t add) {
-			return (tot << 8) + add;
-		};
+		throw std::invalid_argument("Digest output is too large");
+	}
 
-		auto start = chunk_start + (i * 4);
-		auto end = start + 4;
+	finalize();
 
-		words[i] = std::accumulate(start, end, 0, little_endian);
+	for (int i = 0; i < out.size(); ++i)
+	{
+		out[i] = static_cast<uint8_t>(h[i / 4] >> (24 - 8 * (i % 4)));
 	}
 
-	for (int i = 16; i < 80; ++i)
+	reset();
+}
+
+int SHA1::get_block_size()
+{
+	return BLOCK_SIZE;
+}
+
+int SHA1::get_digest_size()
+{
+	return DIGEST_SIZE;
+}
+
+std::unique_ptr<HashFunction> SHA1::clone() const
+{
+	return std::make_unique<SHA1>(*this);
+}
+
+void SHA1::assign(const HashFunction& other)
+{
+	*this = dynamic_cast<const SHA1&>(other);
+}
+
+const SHA1::state& SHA1::get_state() const
+{
+	return h;
+}
+
+const std::array<uint32_t, SHA256::ROUNDS> SHA256::ROUND_CONSTANTS = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+void SHA256::append(const uint8_t* in, uint64_t len)
+{
+	stream_append<SHA256>(h, buffer, buffer_len, message_len, in, len);
+}
+
+void SHA256::append(const HashSegment* segments, std::size_t count)
+{
+	for (std::size_t i = 0; i < count; ++i)
 	{
-		words[i] = left_rotate(words[i - 3] ^ words[i - 8] ^ words[i - 14] ^ words[i - 16], 1);
+		stream_append<SHA256>(h, buffer, buffer_len, message_len, segments[i].data, segments[i].len);
 	}
+}
 
-	return words;
+void SHA256::append(const std::vector<uint8_t>& in)
+{
+	append(in.data(), in.size());
 }
 
-std::vector<uint8_t> SHA1::get_digest()
+void SHA256::append(ConstByteSlice in)
 {
-	uint32_t h0 = 0x67452301;
-	uint32_t h1 = 0xEFCDAB89;
-	uint32_t h2 = 0x98BADCFE;
-	uint32_t h3 = 0x10325476;
-	uint32_t h4 = 0xC3D2E1F0;
+	append(in.data(), in.size());
+}
+
+void SHA256::finalize()
+{
+	stream_finalize<SHA256>(h, buffer, buffer_len, message_len);
+}
+
+void SHA256::reset()
+{
+	h = INITIAL_STATE;
+	buffer_len = 0;
+	message_len = 0;
+}
 
-	std::vector<uint8_t> preprocessed = preprocess_message();
-	
-	for (unsigned int chunk = 0; chunk < preprocessed.size() / BLOCK_SIZE; ++chunk)
+void SHA256::compress_blocks(state& h, const uint8_t* blocks, std::size_t count)
+{
+	if (ni_supported())
 	{
-		std::array<uint32_t, 80> words = get_words(preprocessed.begin() + (BLOCK_SIZE * chunk));
+		compress_blocks_ni(h, blocks, count);
+	}
+	else if (avx2_supported())
+	{
+		compress_blocks_avx2(h, blocks, count);
+	}
+	else
+	{
+		compress_blocks_portable(h, blocks, count);
+	}
+}
 
-		uint32_t a = h0;
-		uint32_t b = h1;
-		uint32_t c = h2;
-		uint32_t d = h3;
-		uint32_t e = h4;
-		uint32_t k = 0;
-		uint32_t f = 0;
+bool SHA256::ni_supported()
+{
+	const CPUFeatures& features = CPUFeatures::get();
+	return features.sha && features.sse41;
+}
 
-		for (int i = 0; i < 80; ++i)
-		{
-			if (0 <= i && i <= 19)
-			{
-				f = (b & c) | ((~b) & d);
-				k = 0x5A827999;
-			}
-			else if (20 <= i && i <= 39)
-			{
-				f = b ^ c ^ d;
-				k = 0x6ED9EBA1;
-			}
-			else if (40 <= i && i <= 59)
-			{
-				f = (b & c) | (b & d) | (c & d);
-				k = 0x8F1BBCDC;
-			}
-			else if(60 <= i && i <= 79)
-			{
-				f = b ^ c ^ d;
-				k = 0xCA62C1D6;
-			}
+bool SHA256::avx2_supported()
+{
+	return CPUFeatures::get().avx2;
+}
+
+void SHA256::compress_blocks_portable(state& h, const uint8_t* blocks, std::size_t count)
+{
+	for (; count > 0; --count, blocks += BLOCK_SIZE)
+	{
+		uint32_t v[8] = { h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7] };
+		uint32_t w[16];
 
-			uint32_t temp = left_rotate(a, 5) + f + e + k + words[i];
-			e = d;
-			d = c;
-			c = left_rotate(b, 30);
-			b = a;
-			a = temp;
+		sha256_rounds(v, w, blocks, std::make_index_sequence<ROUNDS>());
+
+		for (int i = 0; i < 8; ++i)
+		{
+			h[i] += v[i];
 		}
+	}
+}
+
+// schedule holds W[i] + K[i] in groups of four words, stride words apart.
+void SHA256::compress_scheduled(state& h, const uint32_t* schedule, std::size_t stride)
+{
+	uint32_t v[8] = { h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7] };
 
-		h0 += a;
-		h1 += b;
-		h2 += c;
-		h3 += d;
-		h4 += e;
+	sha256_scheduled_rounds(v, schedule, stride, std::make_index_sequence<ROUNDS>());
 
+	for (int i = 0; i < 8; ++i)
+	{
+		h[i] += v[i];
 	}
+}
 
+std::vector<uint8_t> SHA256::get_digest()
+{
 	std::vector<uint8_t> digest(DIGEST_SIZE);
-	reverse_copy(digest.begin(), h0);
-	reverse_copy(digest.begin() + 4, h1);
-	reverse_copy(digest.begin() + 8, h2);
-	reverse_copy(digest.begin() + 12, h3);
-	reverse_copy(digest.begin() + 16, h4);
-	
-	message.clear();
-	message_len = 0;
+	get_digest(ByteSlice(digest.data(), digest.size()));
 	return digest;
 }
 
-void SHA1::reverse_copy(std::vector<uint8_t>::iterator out, uint32_t src)
+void SHA256::get_digest(ByteSlice out)
+{
+	if (out.size() > DIGEST_SIZE)
+	{
+		throw std::invalid_argument("Digest output is too large");
+	}
+
+	finalize();
+
+	for (int i = 0; i < out.size(); ++i)
+	{
+		out[i] = static_cast<uint8_t>(h[i / 4] >> (24 - 8 * (i % 4)));
+	}
+
+	reset();
+}
+
+int SHA256::get_block_size()
 {
-	out[0] = (src & 0xFF << 24) >> 24;
-	out[1] = (src & 0xFF << 16) >> 16;
-	out[2] = (src & 0xFF << 8) >> 8;
-	out[3] = src & 0xFF;	
+	return BLOCK_SIZE;
 }
 
-uint32_t SHA1::left_rotate(uint32_t in, int rotate)
+int SHA256::get_digest_size()
 {
-	uint32_t mask = 0xffffffff << (WORD_SIZE - rotate);
-	uint32_t left = (in & mask) >> (WORD_SIZE - rotate);
-	return (in << rotate) + left;
+	return DIGEST_SIZE;
 }
 
-int SHA1::get_block_size()
+std::unique_ptr<HashFunction> SHA256::clone() const
 {
-	return BLOCK_SIZE;
-}
\ No newline at end of file
+	return std::make_unique<SHA256>(*this);
+}
+
+void SHA256::assign(const HashFunction& other)
+{
+	*this = dynamic_cast<const SHA256&>(other);
+}
+
+const SHA256::state& SHA256::get_state() const
+{
+	return h;
+}
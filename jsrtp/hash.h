@@ -4,25 +4,55 @@
 #include <cstdint>
 #include <vector>
 #include <array>
+#include <memory>
+#include "container_slice.h"
+
+struct DigestRequest
+{
+	const uint8_t* data;
+	std::size_t len;
+	uint8_t* digest;
+};
+
+// One piece of a message that is scattered over several buffers.
+struct HashSegment
+{
+	const uint8_t* data;
+	std::size_t len;
+};
 
 class HashFunction
 {
 public:
 	virtual void append(const uint8_t* in, uint64_t len) = 0;
 	virtual void append(const std::vector<uint8_t>& in) = 0;
+	virtual void append(ConstByteSlice in) = 0;
+	virtual void append(const HashSegment* segments, std::size_t count);
 	virtual std::vector<uint8_t> get_digest() = 0;
+	virtual void get_digest(ByteSlice out) = 0;
+	virtual void reset() = 0;
 	virtual int get_block_size() = 0;
+	virtual int get_digest_size() = 0;
+	virtual std::unique_ptr<HashFunction> clone() const = 0;
+	virtual void assign(const HashFunction& other) = 0;
 	virtual ~HashFunction() {}
 
 };
 
-class SHA1 : public HashFunction
+class SHA1 final : public HashFunction
 {
 public:
 	virtual void append(const uint8_t* in, uint64_t len);
 	virtual void append(const std::vector<uint8_t>& in);
+	virtual void append(ConstByteSlice in);
+	virtual void append(const HashSegment* segments, std::size_t count);
 	virtual std::vector<uint8_t> get_digest();
+	virtual void get_digest(ByteSlice out);
+	virtual void reset();
 	virtual int get_block_size();
+	virtual int get_digest_size();
+	virtual std::unique_ptr<HashFunction> clone() const;
+	virtual void assign(const HashFunction& other);
 
 	constexpr static int BITS_PER_BYTE = 8;
 	constexpr static int MESSAGE_LEN_SIZE = 8;
@@ -30,14 +60,68 @@ public:
 	constexpr static int WORD_SIZE = 32;
 	constexpr static int BLOCK_SIZE = 64;
 
+	using state = std::array<uint32_t, 5>;
+	constexpr static state INITIAL_STATE = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+
+	static void compress_blocks(state& h, const uint8_t* blocks, std::size_t count);
+	static void compress_blocks_portable(state& h, const uint8_t* blocks, std::size_t count);
+	static void compress_blocks_ni(state& h, const uint8_t* blocks, std::size_t count);
+	static bool ni_supported();
+
+	const state& get_state() const;
+
 private:
-	std::vector<uint8_t> message;
-	void reverse_copy(std::vector<uint8_t>::iterator out, uint32_t src);
-	std::array<uint32_t, 80> get_words(std::vector<uint8_t>::iterator chunk_start);
-	std::vector<uint8_t> preprocess_message();
+	state h = INITIAL_STATE;
+	std::array<uint8_t, BLOCK_SIZE> buffer;
+	std::size_t buffer_len = 0;
+	uint64_t message_len = 0;
+
+	void finalize();
+};
 
+class SHA256 final : public HashFunction
+{
+public:
+	virtual void append(const uint8_t* in, uint64_t len);
+	virtual void append(const std::vector<uint8_t>& in);
+	virtual void append(ConstByteSlice in);
+	virtual void append(const HashSegment* segments, std::size_t count);
+	virtual std::vector<uint8_t> get_digest();
+	virtual void get_digest(ByteSlice out);
+	virtual void reset();
+	virtual int get_block_size();
+	virtual int get_digest_size();
+	virtual std::unique_ptr<HashFunction> clone() const;
+	virtual void assign(const HashFunction& other);
+
+	constexpr static int BITS_PER_BYTE = 8;
+	constexpr static int MESSAGE_LEN_SIZE = 8;
+	constexpr static int DIGEST_SIZE = 32;
+	constexpr static int WORD_SIZE = 32;
+	constexpr static int BLOCK_SIZE = 64;
+	constexpr static int ROUNDS = 64;
+
+	using state = std::array<uint32_t, 8>;
+	constexpr static state INITIAL_STATE = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+	static const std::array<uint32_t, ROUNDS> ROUND_CONSTANTS;
+
+	static void compress_blocks(state& h, const uint8_t* blocks, std::size_t count);
+	static void compress_blocks_portable(state& h, const uint8_t* blocks, std::size_t count);
+	static void compress_blocks_ni(state& h, const uint8_t* blocks, std::size_t count);
+	static void compress_blocks_avx2(state& h, const uint8_t* blocks, std::size_t count);
+	static void compress_scheduled(state& h, const uint32_t* schedule, std::size_t stride);
+	static bool ni_supported();
+	static bool avx2_supported();
+
+	const state& get_state() const;
+
+private:
+	state h = INITIAL_STATE;
+	std::array<uint8_t, BLOCK_SIZE> buffer;
+	std::size_t buffer_len = 0;
 	uint64_t message_len = 0;
-	uint32_t left_rotate(uint32_t in, int rotate);
+
+	void finalize();
 };
 
 #endif
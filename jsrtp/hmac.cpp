@@ -1,54 +1,258 @@
 #include "HMAC.h"
+#include "sha1_mb.h"
 
-HMAC::HMAC() : hash(std::make_unique<SHA1>()) {}
+// SHA-NI hashes one packet faster than the multi-buffer lanes do, and a batch
+// that cannot fill the lanes is cheaper one packet at a time.
+template<>
+void HMACFixed<SHA1>::get_digests(DigestRequest* requests, std::size_t count)
+{
+	if (SHA1::ni_supported() || count < SHA1MultiBuffer::get_lanes())
+	{
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			append(requests[i].data, requests[i].len);
+			get_digest(ByteSlice(requests[i].digest, static_cast<std::size_t>(digest_size)));
+		}
+		return;
+	}
+
+	std::array<SHA1MultiBuffer::Job, SHA1MultiBuffer::max_jobs> jobs;
+
+	while (count > 0)
+	{
+		std::size_t n = std::min(count, SHA1MultiBuffer::max_jobs);
+
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			jobs[i] = SHA1MultiBuffer::Job();
+			jobs[i].data = requests[i].data;
+			jobs[i].len = requests[i].len;
+			jobs[i].h = inner_start.get_state();
+			jobs[i].prefix_len = SHA1::BLOCK_SIZE;
+		}
+
+		SHA1MultiBuffer::finish(jobs.data(), n);
+
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			SHA1MultiBuffer::store_digest(jobs[i].h, requests[i].digest);
+			jobs[i].data = requests[i].digest;
+			jobs[i].len = SHA1::DIGEST_SIZE;
+			jobs[i].h = outer_start.get_state();
+		}
+
+		SHA1MultiBuffer::finish(jobs.data(), n);
+
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			SHA1MultiBuffer::store_digest(jobs[i].h, requests[i].digest);
+		}
+
+		requests += n;
+		count -= n;
+	}
+}
+
+template<class Hash>
+class HMAC::FixedEngine : public HMAC::Engine
+{
+public:
+	virtual void set_key(const uint8_t* key, std::size_t len)
+	{
+		mac.set_key(key, len);
+	}
+
+	virtual void append(const uint8_t* in, uint64_t len)
+	{
+		mac.append(in, len);
+	}
+
+	virtual void get_digest(ByteSlice out)
+	{
+		mac.get_digest(out);
+	}
+
+	virtual void get_digests(DigestRequest* requests, std::size_t count)
+	{
+		mac.get_digests(requests, count);
+	}
+
+	virtual int get_digest_size() const
+	{
+		return Hash::DIGEST_SIZE;
+	}
+
+private:
+	HMACFixed<Hash> mac;
+};
+
+class HMAC::GenericEngine : public HMAC::Engine
+{
+public:
+	GenericEngine(std::unique_ptr<HashFunction> in_hash) : hash(std::move(in_hash))
+	{
+		outer = hash->clone();
+	}
+
+	virtual void set_key(const uint8_t* key, std::size_t len)
+	{
+		std::vector<uint8_t> key_block = get_key_block(std::vector<uint8_t>(key, key + len));
+		std::vector<uint8_t> pad(key_block.size());
+
+		hash->reset();
+		outer->reset();
+
+		std::transform(key_block.begin(), key_block.end(), pad.begin(), [](uint8_t in) {return in ^ 0x36; });
+		hash->append(pad);
+		inner_start = hash->clone();
+
+		std::transform(key_block.begin(), key_block.end(), pad.begin(), [](uint8_t in) { return in ^ 0x5c; });
+		outer->append(pad);
+		outer_start = outer->clone();
+	}
+
+	virtual void append(const uint8_t* in, uint64_t len)
+	{
+		hash->append(in, len);
+	}
+
+	virtual void get_digest(ByteSlice out)
+	{
+		if (out.size() > hash->get_digest_size())
+		{
+			throw std::invalid_argument("Digest output is too large");
+		}
+
+		std::array<uint8_t, max_digest_size> inner_digest;
+		ByteSlice inner_slice(inner_digest.data(), static_cast<std::size_t>(hash->get_digest_size()));
 
-HMAC::HMAC(std::unique_ptr<HashFunction> in_hash) : hash(std::move(in_hash)) {}
+		hash->get_digest(inner_slice);
+		hash->assign(*inner_start);
+
+		outer->append(ConstByteSlice(inner_slice.data(), inner_slice.size()));
+		outer->get_digest(out);
+		outer->assign(*outer_start);
+	}
+
+	virtual void get_digests(DigestRequest* requests, std::size_t count)
+	{
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			append(requests[i].data, requests[i].len);
+			get_digest(ByteSlice(requests[i].digest, static_cast<std::size_t>(outer->get_digest_size())));
+		}
+	}
+
+	virtual int get_digest_size() const
+	{
+		return outer->get_digest_size();
+	}
+
+private:
+	std::unique_ptr<HashFunction> hash = nullptr;
+	std::unique_ptr<HashFunction> outer = nullptr;
+	std::unique_ptr<HashFunction> inner_start = nullptr;
+	std::unique_ptr<HashFunction> outer_start = nullptr;
+
+	std::vector<uint8_t> get_key_block(std::vector<uint8_t> key)
+	{
+		unsigned int block_size = hash->get_block_size();
+		auto key_hash = hash->clone();
+		key_hash->reset();
+
+		if (key.size() > block_size)
+		{
+			key_hash->append(key);
+			key = key_hash->get_digest();
+		}
+
+		key.resize(block_size, 0);
+		return key;
+	}
+};
+
+HMAC::HMAC() : engine(std::make_unique<FixedEngine<SHA1>>()) {}
+
+HMAC::HMAC(std::unique_ptr<HashFunction> in_hash)
+{
+	if (dynamic_cast<SHA1*>(in_hash.get()) != nullptr)
+	{
+		engine = std::make_unique<FixedEngine<SHA1>>();
+	}
+	else if (dynamic_cast<SHA256*>(in_hash.get()) != nullptr)
+	{
+		engine = std::make_unique<FixedEngine<SHA256>>();
+	}
+	else
+	{
+		engine = std::make_unique<GenericEngine>(std::move(in_hash));
+		engine->set_key(nullptr, 0);
+	}
+}
 
 void HMAC::set_key(std::vector<uint8_t> in_key)
 {
-	key = std::move(in_key);
+	engine->set_key(in_key.data(), in_key.size());
 }
 
 void HMAC::append(const uint8_t* in, uint64_t len)
 {
-	std::copy(in, in + len, std::back_inserter(message));
+	engine->append(in, len);
 }
 
 void HMAC::append(const std::vector<uint8_t>& in)
 {
-	std::copy(in.begin(), in.end(), std::back_inserter(message));
+	engine->append(in.data(), in.size());
 }
 
-std::vector<uint8_t> HMAC::get_digest()
+void HMAC::append(ConstByteSlice in)
 {
-	unsigned int block_size = hash->get_block_size();
-	
-	if (key.size() > block_size)
-	{
-		hash->append(key);
-		key = hash->get_digest();
-	}
-	
-	if (key.size() < block_size)
+	engine->append(in.data(), in.size());
+}
+
+void HMAC::append(const HashSegment* segments, std::size_t count)
+{
+	for (std::size_t i = 0; i < count; ++i)
 	{
-		int to_pad = block_size - key.size();
-		std::fill_n(std::back_inserter(key), to_pad, 0);
+		engine->append(segments[i].data, segments[i].len);
 	}
+}
 
-	std::vector<uint8_t> o_key_pad (block_size);
-	std::transform(key.begin(), key.end(), o_key_pad.begin(), [](uint8_t in) { return in ^ 0x5c; });
+std::vector<uint8_t> HMAC::get_digest()
+{
+	std::vector<uint8_t> digest(engine->get_digest_size());
+	get_digest(ByteSlice(digest.data(), digest.size()));
+	return digest;
+}
 
-	std::vector<uint8_t> i_key_pad (block_size);
-	std::transform(key.begin(), key.end(), i_key_pad.begin(), [](uint8_t in) {return in ^ 0x36; });
+void HMAC::get_digest(ByteSlice out)
+{
+	engine->get_digest(out);
+}
 
-	hash->append(i_key_pad);
-	hash->append(message);
+void HMAC::get_digests(DigestRequest* requests, std::size_t count)
+{
+	engine->get_digests(requests, count);
+}
 
-	message.clear();
+bool HMAC::verify(ConstByteSlice tag)
+{
+	if (static_cast<std::size_t>(tag.size()) > static_cast<std::size_t>(engine->get_digest_size()))
+	{
+		throw std::invalid_argument("Tag is longer than the digest");
+	}
 
-	auto inner_digest = hash->get_digest();
-	hash->append(o_key_pad);
-	hash->append(inner_digest);
+	std::array<uint8_t, max_digest_size> digest;
+	get_digest(ByteSlice(digest.data(), tag.size()));
+	return tags_equal(digest.data(), tag.data(), tag.size());
+}
 
-	return  hash->get_digest();
-}
\ No newline at end of file
+bool HMAC::tags_equal(const uint8_t* a, const uint8_t* b, std::size_t len)
+{
+	uint8_t diff = 0;
+	for (std::size_t i = 0; i < len; ++i)
+	{
+		diff |= a[i] ^ b[i];
+	}
+	return diff == 0;
+}
@@ -1,9 +1,37 @@
 #ifndef __HMAC_H__
 #define __HMAC_H__
 #include <vector>
+#include <array>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
 #include "hash.h"
 
 
+template<class Hash>
+class HMACFixed
+{
+public:
+	constexpr static int block_size = Hash::BLOCK_SIZE;
+	constexpr static int digest_size = Hash::DIGEST_SIZE;
+
+	HMACFixed();
+	void set_key(const uint8_t* key, std::size_t len);
+	void set_key(const std::vector<uint8_t>& key);
+	void append(const uint8_t* in, uint64_t len);
+	void append(ConstByteSlice in);
+	void append(const HashSegment* segments, std::size_t count);
+	std::array<uint8_t, digest_size> get_digest();
+	void get_digest(ByteSlice out);
+	void get_digests(DigestRequest* requests, std::size_t count);
+	bool verify(ConstByteSlice tag);
+private:
+	Hash inner;
+	Hash outer;
+	Hash inner_start;
+	Hash outer_start;
+};
+
 class HMAC
 {
 public:
@@ -12,12 +40,144 @@ public:
 	void set_key(std::vector<uint8_t> in_key);
 	void append(const uint8_t* in, uint64_t len);
 	void append(const std::vector<uint8_t>& in);
+	void append(ConstByteSlice in);
+	void append(const HashSegment* segments, std::size_t count);
 	std::vector<uint8_t> get_digest();
+	void get_digest(ByteSlice out);
+	void get_digests(DigestRequest* requests, std::size_t count);
+	bool verify(ConstByteSlice tag);
+
+	static bool tags_equal(const uint8_t* a, const uint8_t* b, std::size_t len);
 private:
-	std::vector<uint8_t> key;
-	std::vector<uint8_t> message;
-	std::unique_ptr<HashFunction> hash = nullptr;
+	constexpr static int max_digest_size = 64;
+
+	class Engine
+	{
+	public:
+		virtual void set_key(const uint8_t* key, std::size_t len) = 0;
+		virtual void append(const uint8_t* in, uint64_t len) = 0;
+		virtual void get_digest(ByteSlice out) = 0;
+		virtual void get_digests(DigestRequest* requests, std::size_t count) = 0;
+		virtual int get_digest_size() const = 0;
+		virtual ~Engine() {}
+	};
+
+	template<class Hash>
+	class FixedEngine;
+	class GenericEngine;
+
+	std::unique_ptr<Engine> engine;
 };
 
-#endif
+template<class Hash>
+HMACFixed<Hash>::HMACFixed()
+{
+	set_key(nullptr, 0);
+}
+
+template<class Hash>
+void HMACFixed<Hash>::set_key(const std::vector<uint8_t>& key)
+{
+	set_key(key.data(), key.size());
+}
+
+template<class Hash>
+void HMACFixed<Hash>::set_key(const uint8_t* key, std::size_t len)
+{
+	std::array<uint8_t, block_size> key_block = {};
+
+	if (len > block_size)
+	{
+		Hash key_hash;
+		key_hash.append(key, len);
+		key_hash.get_digest(ByteSlice(key_block.data(), static_cast<std::size_t>(digest_size)));
+	}
+	else
+	{
+		std::copy(key, key + len, key_block.begin());
+	}
+
+	std::array<uint8_t, block_size> pad;
+
+	inner.reset();
+	std::transform(key_block.begin(), key_block.end(), pad.begin(), [](uint8_t in) { return in ^ 0x36; });
+	inner.append(pad.data(), pad.size());
+	inner_start = inner;
+
+	outer.reset();
+	std::transform(key_block.begin(), key_block.end(), pad.begin(), [](uint8_t in) { return in ^ 0x5c; });
+	outer.append(pad.data(), pad.size());
+	outer_start = outer;
+}
 
+template<class Hash>
+void HMACFixed<Hash>::append(const uint8_t* in, uint64_t len)
+{
+	inner.append(in, len);
+}
+
+template<class Hash>
+void HMACFixed<Hash>::append(ConstByteSlice in)
+{
+	inner.append(in.data(), in.size());
+}
+
+template<class Hash>
+void HMACFixed<Hash>::append(const HashSegment* segments, std::size_t count)
+{
+	inner.append(segments, count);
+}
+
+template<class Hash>
+std::array<uint8_t, HMACFixed<Hash>::digest_size> HMACFixed<Hash>::get_digest()
+{
+	std::array<uint8_t, digest_size> digest;
+	get_digest(ByteSlice(digest.data(), digest.size()));
+	return digest;
+}
+
+template<class Hash>
+void HMACFixed<Hash>::get_digest(ByteSlice out)
+{
+	if (out.size() > digest_size)
+	{
+		throw std::invalid_argument("Digest output is too large");
+	}
+
+	std::array<uint8_t, digest_size> inner_digest;
+
+	inner.get_digest(ByteSlice(inner_digest.data(), inner_digest.size()));
+	inner = inner_start;
+
+	outer.append(inner_digest.data(), inner_digest.size());
+	outer.get_digest(out);
+	outer = outer_start;
+}
+
+template<class Hash>
+void HMACFixed<Hash>::get_digests(DigestRequest* requests, std::size_t count)
+{
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		append(requests[i].data, requests[i].len);
+		get_digest(ByteSlice(requests[i].digest, static_cast<std::size_t>(digest_size)));
+	}
+}
+
+template<class Hash>
+bool HMACFixed<Hash>::verify(ConstByteSlice tag)
+{
+	if (tag.size() > digest_size)
+	{
+		throw std::invalid_argument("Tag is longer than the digest");
+	}
+
+	std::array<uint8_t, digest_size> digest;
+	get_digest(ByteSlice(digest.data(), tag.size()));
+	return HMAC::tags_equal(digest.data(), tag.data(), tag.size());
+}
+
+template<>
+void HMACFixed<SHA1>::get_digests(DigestRequest* requests, std::size_t count);
+
+#endif
@@ -0,0 +1,85 @@
+#include "replay_window.h"
+#include <algorithm>
+#include <stdexcept>
+
+ReplayWindow::ReplayWindow(std::size_t in_size) : size(in_size)
+{
+	if (size < min_size || size > max_size)
+	{
+		throw std::invalid_argument("Replay window size must be between 64 and 32768");
+	}
+
+	std::size_t words = 1;
+	while (words < (size + word_bits - 1) / word_bits + 1)
+	{
+		words <<= 1;
+	}
+
+	bitmap.resize(words, 0);
+	word_mask = words - 1;
+}
+
+std::size_t ReplayWindow::get_size() const
+{
+	return size;
+}
+
+uint64_t ReplayWindow::get_highest() const
+{
+	return highest;
+}
+
+bool ReplayWindow::check(uint64_t index) const
+{
+	if (!initialized || index > highest)
+	{
+		return true;
+	}
+
+	if (highest - index >= size)
+	{
+		return false;
+	}
+
+	return ((bitmap[(index / word_bits) & word_mask] >> (index % word_bits)) & 1) == 0;
+}
+
+void ReplayWindow::check(const uint64_t* indices, std::size_t count, bool* accepted) const
+{
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		accepted[i] = check(indices[i]);
+	}
+}
+
+bool ReplayWindow::update(uint64_t index)
+{
+	if (!check(index))
+	{
+		return false;
+	}
+
+	if (!initialized || index > highest)
+	{
+		uint64_t top_word = index / word_bits;
+		uint64_t advance = initialized ? top_word - highest / word_bits : bitmap.size();
+
+		if (advance >= bitmap.size())
+		{
+			std::fill(bitmap.begin(), bitmap.end(), 0);
+		}
+		else
+		{
+			for (uint64_t word = top_word - advance + 1; word <= top_word; ++word)
+			{
+				bitmap[word & word_mask] = 0;
+			}
+		}
+
+		highest = index;
+		initialized = true;
+	}
+
+	bitmap[(index / word_bits) & word_mask] |= uint64_t(1) << (index % word_bits);
+	return true;
+}
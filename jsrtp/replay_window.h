@@ -0,0 +1,32 @@
+#ifndef __REPLAY_WINDOW_H__
+#define __REPLAY_WINDOW_H__
+
+#include <cstdint>
+#include <vector>
+
+class ReplayWindow
+{
+public:
+	constexpr static std::size_t min_size = 64;
+	constexpr static std::size_t max_size = 1 << 15;
+
+	ReplayWindow(std::size_t in_size = min_size);
+
+	bool check(uint64_t index) const;
+	void check(const uint64_t* indices, std::size_t count, bool* accepted) const;
+	bool update(uint64_t index);
+
+	std::size_t get_size() const;
+	uint64_t get_highest() const;
+
+private:
+	constexpr static int word_bits = 64;
+
+	std::size_t size;
+	std::vector<uint64_t> bitmap;
+	uint64_t word_mask;
+	uint64_t highest = 0;
+	bool initialized = false;
+};
+
+#endif
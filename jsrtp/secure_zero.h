@@ -0,0 +1,17 @@
+#ifndef __SECURE_ZERO_H__
+#define __SECURE_ZERO_H__
+
+#include <cstddef>
+#include <cstdint>
+
+// Wipes key material in a way the compiler cannot drop as a dead store.
+inline void secure_zero(void* data, std::size_t len)
+{
+	volatile uint8_t* bytes = static_cast<volatile uint8_t*>(data);
+	for (std::size_t i = 0; i < len; ++i)
+	{
+		bytes[i] = 0;
+	}
+}
+
+#endif
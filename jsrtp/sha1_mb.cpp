@@ -0,0 +1,93 @@
+#include "sha1_mb.h"
+#include "cpu_features.h"
+#include <algorithm>
+#include <utility>
+#include <emmintrin.h>
+#include "sha1_mb_lanes.h"
+
+namespace
+{
+	struct SSE2Lanes
+	{
+		using vec = __m128i;
+		constexpr static int lanes = 4;
+
+		static vec load(const uint32_t* in) { return _mm_load_si128(reinterpret_cast<const __m128i*>(in)); }
+		static void store(uint32_t* out, vec in) { _mm_store_si128(reinterpret_cast<__m128i*>(out), in); }
+		static vec set1(uint32_t in) { return _mm_set1_epi32(static_cast<int>(in)); }
+		static vec add(vec a, vec b) { return _mm_add_epi32(a, b); }
+		static vec bit_and(vec a, vec b) { return _mm_and_si128(a, b); }
+		static vec bit_or(vec a, vec b) { return _mm_or_si128(a, b); }
+		static vec bit_xor(vec a, vec b) { return _mm_xor_si128(a, b); }
+		static vec bit_andnot(vec a, vec b) { return _mm_andnot_si128(a, b); }
+		static vec xor3(vec a, vec b, vec c) { return _mm_xor_si128(_mm_xor_si128(a, b), c); }
+
+		template<int bits>
+		static vec rotate_left(vec in) { return _mm_or_si128(_mm_slli_epi32(in, bits), _mm_srli_epi32(in, 32 - bits)); }
+	};
+}
+
+void SHA1MultiBuffer::finish(Job* jobs, std::size_t count)
+{
+	if (avx2_supported())
+	{
+		finish_avx2(jobs, count);
+	}
+	else
+	{
+		finish_sse2(jobs, count);
+	}
+}
+
+void SHA1MultiBuffer::finish_sse2(Job* jobs, std::size_t count)
+{
+	sha1_lane_finish<SSE2Lanes>(jobs, count);
+}
+
+bool SHA1MultiBuffer::avx2_supported()
+{
+	return CPUFeatures::get().avx2;
+}
+
+std::size_t SHA1MultiBuffer::get_lanes()
+{
+	return avx2_supported() ? 8 : 4;
+}
+
+void SHA1MultiBuffer::hash(DigestRequest* requests, std::size_t count)
+{
+	std::array<Job, max_jobs> jobs;
+
+	while (count > 0)
+	{
+		std::size_t n = std::min(count, max_jobs);
+
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			jobs[i] = Job();
+			jobs[i].data = requests[i].data;
+			jobs[i].len = requests[i].len;
+		}
+
+		finish(jobs.data(), n);
+
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			store_digest(jobs[i].h, requests[i].digest);
+		}
+
+		requests += n;
+		count -= n;
+	}
+}
+
+void SHA1MultiBuffer::store_digest(const SHA1::state& h, uint8_t* out)
+{
+	for (int j = 0; j < 5; ++j)
+	{
+		out[j * 4] = static_cast<uint8_t>(h[j] >> 24);
+		out[j * 4 + 1] = static_cast<uint8_t>(h[j] >> 16);
+		out[j * 4 + 2] = static_cast<uint8_t>(h[j] >> 8);
+		out[j * 4 + 3] = static_cast<uint8_t>(h[j]);
+	}
+}
@@ -0,0 +1,31 @@
+#ifndef __SHA1_MB_H__
+#define __SHA1_MB_H__
+
+#include <cstdint>
+#include <array>
+#include "hash.h"
+
+class SHA1MultiBuffer
+{
+public:
+	constexpr static std::size_t max_jobs = 64;
+
+	struct Job
+	{
+		const uint8_t* data = nullptr;
+		std::size_t len = 0;
+		SHA1::state h = SHA1::INITIAL_STATE;
+		uint64_t prefix_len = 0;
+	};
+
+	static void finish(Job* jobs, std::size_t count);
+	static void finish_sse2(Job* jobs, std::size_t count);
+	static void finish_avx2(Job* jobs, std::size_t count);
+	static void hash(DigestRequest* requests, std::size_t count);
+
+	static void store_digest(const SHA1::state& h, uint8_t* out);
+	static bool avx2_supported();
+	static std::size_t get_lanes();
+};
+
+#endif
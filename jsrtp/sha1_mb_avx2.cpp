@@ -0,0 +1,39 @@
+#include "sha1_mb.h"
+#include <algorithm>
+#include <utility>
+#include <immintrin.h>
+
+// Only code below this point is built for AVX2; standard headers must be
+// included above so their inline functions are not.
+#if defined(__GNUC__)
+#pragma GCC target("avx2")
+#endif
+
+#include "sha1_mb_lanes.h"
+
+namespace
+{
+	struct AVX2Lanes
+	{
+		using vec = __m256i;
+		constexpr static int lanes = 8;
+
+		static vec load(const uint32_t* in) { return _mm256_load_si256(reinterpret_cast<const __m256i*>(in)); }
+		static void store(uint32_t* out, vec in) { _mm256_store_si256(reinterpret_cast<__m256i*>(out), in); }
+		static vec set1(uint32_t in) { return _mm256_set1_epi32(static_cast<int>(in)); }
+		static vec add(vec a, vec b) { return _mm256_add_epi32(a, b); }
+		static vec bit_and(vec a, vec b) { return _mm256_and_si256(a, b); }
+		static vec bit_or(vec a, vec b) { return _mm256_or_si256(a, b); }
+		static vec bit_xor(vec a, vec b) { return _mm256_xor_si256(a, b); }
+		static vec bit_andnot(vec a, vec b) { return _mm256_andnot_si256(a, b); }
+		static vec xor3(vec a, vec b, vec c) { return _mm256_xor_si256(_mm256_xor_si256(a, b), c); }
+
+		template<int bits>
+		static vec rotate_left(vec in) { return _mm256_or_si256(_mm256_slli_epi32(in, bits), _mm256_srli_epi32(in, 32 - bits)); }
+	};
+}
+
+void SHA1MultiBuffer::finish_avx2(Job* jobs, std::size_t count)
+{
+	sha1_lane_finish<AVX2Lanes>(jobs, count);
+}
@@ -0,0 +1,198 @@
+#ifndef __SHA1_MB_LANES_H__
+#define __SHA1_MB_LANES_H__
+
+// Lane-parallel SHA1 shared by sha1_mb.cpp (SSE2) and sha1_mb_avx2.cpp
+// (AVX2). Everything has internal linkage so each file can compile it for
+// its own instruction set.
+
+#include "sha1_mb.h"
+
+namespace
+{
+	template<class V, int i>
+	inline void sha1_lane_round(typename V::vec* v, typename V::vec* w, const uint32_t (*words)[V::lanes])
+	{
+		using vec = typename V::vec;
+
+		vec& a = v[(80 - i) % 5];
+		vec& b = v[(81 - i) % 5];
+		vec& c = v[(82 - i) % 5];
+		vec& d = v[(83 - i) % 5];
+		vec& e = v[(84 - i) % 5];
+
+		if constexpr (i < 16)
+		{
+			w[i] = V::load(words[i]);
+		}
+		else
+		{
+			w[i & 15] = V::template rotate_left<1>(V::xor3(V::bit_xor(w[(i + 13) & 15], w[(i + 8) & 15]), w[(i + 2) & 15], w[i & 15]));
+		}
+
+		vec f;
+		if constexpr (i < 20)
+		{
+			f = V::add(V::bit_or(V::bit_and(b, c), V::bit_andnot(b, d)), V::set1(0x5A827999));
+		}
+		else if constexpr (i < 40)
+		{
+			f = V::add(V::xor3(b, c, d), V::set1(0x6ED9EBA1));
+		}
+		else if constexpr (i < 60)
+		{
+			f = V::add(V::bit_or(V::bit_and(b, c), V::bit_and(d, V::bit_or(b, c))), V::set1(0x8F1BBCDC));
+		}
+		else
+		{
+			f = V::add(V::xor3(b, c, d), V::set1(0xCA62C1D6));
+		}
+
+		e = V::add(V::add(e, f), V::add(V::template rotate_left<5>(a), w[i & 15]));
+		b = V::template rotate_left<30>(b);
+	}
+
+	template<class V, std::size_t... i>
+	inline void sha1_lane_rounds(typename V::vec* v, typename V::vec* w, const uint32_t (*words)[V::lanes], std::index_sequence<i...>)
+	{
+		(sha1_lane_round<V, i>(v, w, words), ...);
+	}
+
+	template<class V>
+	void sha1_lane_compress(uint32_t (*h)[V::lanes], const uint8_t* const* blocks)
+	{
+		using vec = typename V::vec;
+
+		alignas(32) uint32_t words[16][V::lanes];
+		for (int t = 0; t < 16; ++t)
+		{
+			for (int lane = 0; lane < V::lanes; ++lane)
+			{
+				const uint8_t* in = blocks[lane] + t * 4;
+				words[t][lane] = (static_cast<uint32_t>(in[0]) << 24) | (static_cast<uint32_t>(in[1]) << 16) |
+					(static_cast<uint32_t>(in[2]) << 8) | static_cast<uint32_t>(in[3]);
+			}
+		}
+
+		vec v[5];
+		vec w[16];
+		for (int j = 0; j < 5; ++j)
+		{
+			v[j] = V::load(h[j]);
+		}
+
+		sha1_lane_rounds<V>(v, w, words, std::make_index_sequence<80>());
+
+		for (int j = 0; j < 5; ++j)
+		{
+			V::store(h[j], V::add(V::load(h[j]), v[j]));
+		}
+	}
+
+	struct LaneQueue
+	{
+		SHA1MultiBuffer::Job* job = nullptr;
+		const uint8_t* next = nullptr;
+		std::size_t full_blocks = 0;
+		int tail_blocks = 0;
+		int tail_index = 0;
+		alignas(16) uint8_t tail[2 * SHA1::BLOCK_SIZE];
+
+		void assign(SHA1MultiBuffer::Job* in_job)
+		{
+			job = in_job;
+			next = job->data;
+			full_blocks = job->len / SHA1::BLOCK_SIZE;
+
+			std::size_t tail_len = job->len % SHA1::BLOCK_SIZE;
+			tail_blocks = (tail_len + 1 + SHA1::MESSAGE_LEN_SIZE > SHA1::BLOCK_SIZE) ? 2 : 1;
+			tail_index = 0;
+
+			std::size_t padded = static_cast<std::size_t>(tail_blocks) * SHA1::BLOCK_SIZE;
+			std::copy(next + full_blocks * SHA1::BLOCK_SIZE, next + job->len, tail);
+			tail[tail_len] = 0x80;
+			std::fill(tail + tail_len + 1, tail + padded, 0x0);
+
+			uint64_t message_len = (job->prefix_len + job->len) * SHA1::BITS_PER_BYTE;
+			for (int i = 0; i < SHA1::MESSAGE_LEN_SIZE; ++i)
+			{
+				tail[padded - 1 - i] = static_cast<uint8_t>(message_len >> (i * SHA1::BITS_PER_BYTE));
+			}
+		}
+
+		const uint8_t* next_block()
+		{
+			if (full_blocks > 0)
+			{
+				const uint8_t* block = next;
+				next += SHA1::BLOCK_SIZE;
+				--full_blocks;
+				return block;
+			}
+
+			return tail + SHA1::BLOCK_SIZE * tail_index++;
+		}
+
+		bool done() const
+		{
+			return full_blocks == 0 && tail_index == tail_blocks;
+		}
+	};
+
+	template<class V>
+	void sha1_lane_finish(SHA1MultiBuffer::Job* jobs, std::size_t count)
+	{
+		constexpr int lanes = V::lanes;
+		alignas(32) static const uint8_t idle_block[SHA1::BLOCK_SIZE] = {};
+
+		alignas(32) uint32_t h[5][lanes] = {};
+		LaneQueue queues[lanes];
+		const uint8_t* blocks[lanes];
+		std::size_t next_job = 0;
+		int active = 0;
+
+		auto load_lane = [&](int lane) {
+			if (next_job == count)
+			{
+				queues[lane].job = nullptr;
+				return;
+			}
+
+			queues[lane].assign(&jobs[next_job++]);
+			for (int j = 0; j < 5; ++j)
+			{
+				h[j][lane] = queues[lane].job->h[j];
+			}
+			++active;
+		};
+
+		for (int lane = 0; lane < lanes; ++lane)
+		{
+			load_lane(lane);
+		}
+
+		while (active > 0)
+		{
+			for (int lane = 0; lane < lanes; ++lane)
+			{
+				blocks[lane] = queues[lane].job ? queues[lane].next_block() : idle_block;
+			}
+
+			sha1_lane_compress<V>(h, blocks);
+
+			for (int lane = 0; lane < lanes; ++lane)
+			{
+				if (queues[lane].job && queues[lane].done())
+				{
+					for (int j = 0; j < 5; ++j)
+					{
+						queues[lane].job->h[j] = h[j][lane];
+					}
+					--active;
+					load_lane(lane);
+				}
+			}
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,82 @@
+#include "hash.h"
+#include "cpu_features.h"
+#include <immintrin.h>
+#include <utility>
+
+namespace
+{
+	// Each group covers four rounds. While group g runs, the message words
+	// for groups g + 1 to g + 3 are completed with sha1msg1/sha1msg2.
+	template<int g>
+	JSRTP_TARGET("sha,sse4.1")
+	inline void sha1_ni_group(__m128i& abcd, __m128i& e0, __m128i& e1, __m128i* msg, const uint8_t* block)
+	{
+		__m128i& e = (g % 2 == 0) ? e0 : e1;
+		__m128i& e_next = (g % 2 == 0) ? e1 : e0;
+		__m128i& current = msg[g % 4];
+
+		if constexpr (g < 4)
+		{
+			const __m128i byte_swap = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+			current = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block + g * 16)), byte_swap);
+		}
+
+		if constexpr (g == 0)
+		{
+			e = _mm_add_epi32(e, current);
+		}
+		else
+		{
+			e = _mm_sha1nexte_epu32(e, current);
+		}
+
+		e_next = abcd;
+
+		if constexpr (g >= 3 && g <= 18)
+		{
+			msg[(g + 1) % 4] = _mm_sha1msg2_epu32(msg[(g + 1) % 4], current);
+		}
+
+		abcd = _mm_sha1rnds4_epu32(abcd, e, g / 5);
+
+		if constexpr (g >= 1 && g <= 16)
+		{
+			msg[(g + 3) % 4] = _mm_sha1msg1_epu32(msg[(g + 3) % 4], current);
+		}
+
+		if constexpr (g >= 2 && g <= 17)
+		{
+			msg[(g + 2) % 4] = _mm_xor_si128(msg[(g + 2) % 4], current);
+		}
+	}
+
+	template<std::size_t... g>
+	JSRTP_TARGET("sha,sse4.1")
+	inline void sha1_ni_groups(__m128i& abcd, __m128i& e0, __m128i& e1, __m128i* msg, const uint8_t* block, std::index_sequence<g...>)
+	{
+		(sha1_ni_group<g>(abcd, e0, e1, msg, block), ...);
+	}
+}
+
+JSRTP_TARGET("sha,sse4.1")
+void SHA1::compress_blocks_ni(state& h, const uint8_t* blocks, std::size_t count)
+{
+	__m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(h.data())), 0x1B);
+	__m128i e0 = _mm_set_epi32(static_cast<int>(h[4]), 0, 0, 0);
+	__m128i e1;
+	__m128i msg[4];
+
+	for (; count > 0; --count, blocks += BLOCK_SIZE)
+	{
+		__m128i abcd_save = abcd;
+		__m128i e0_save = e0;
+
+		sha1_ni_groups(abcd, e0, e1, msg, blocks, std::make_index_sequence<20>());
+
+		e0 = _mm_sha1nexte_epu32(e0, e0_save);
+		abcd = _mm_add_epi32(abcd, abcd_save);
+	}
+
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(h.data()), _mm_shuffle_epi32(abcd, 0x1B));
+	h[4] = static_cast<uint32_t>(_mm_extract_epi32(e0, 3));
+}
@@ -0,0 +1,88 @@
+#include "hash.h"
+#include "cpu_features.h"
+#include <immintrin.h>
+
+namespace
+{
+	template<int bits>
+	JSRTP_TARGET("avx2")
+	inline __m256i rotate_right(__m256i in)
+	{
+		return _mm256_or_si256(_mm256_srli_epi32(in, bits), _mm256_slli_epi32(in, 32 - bits));
+	}
+
+	JSRTP_TARGET("avx2")
+	inline __m256i sigma0(__m256i in)
+	{
+		return _mm256_xor_si256(_mm256_xor_si256(rotate_right<7>(in), rotate_right<18>(in)), _mm256_srli_epi32(in, 3));
+	}
+
+	JSRTP_TARGET("avx2")
+	inline __m256i sigma1(__m256i in)
+	{
+		return _mm256_xor_si256(_mm256_xor_si256(rotate_right<17>(in), rotate_right<19>(in)), _mm256_srli_epi32(in, 10));
+	}
+
+	// Expands the message schedules of two blocks at once, one block per
+	// 128-bit lane, and stores W + K as groups of four words: the first
+	// block's group g at schedule + 8 * g, the second block's four words later.
+	JSRTP_TARGET("avx2")
+	void schedule_pair(const uint8_t* first, const uint8_t* second, uint32_t* schedule)
+	{
+		const __m256i byte_swap = _mm256_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL, 0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+		__m256i w[4];
+
+		for (int g = 0; g < SHA256::ROUNDS / 4; ++g)
+		{
+			__m256i current;
+
+			if (g < 4)
+			{
+				__m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(first + g * 16))),
+					_mm_loadu_si128(reinterpret_cast<const __m128i*>(second + g * 16)), 1);
+				current = _mm256_shuffle_epi8(in, byte_swap);
+			}
+			else
+			{
+				__m256i w16 = w[g % 4];
+				__m256i w15 = _mm256_alignr_epi8(w[(g + 1) % 4], w16, 4);
+				__m256i w7 = _mm256_alignr_epi8(w[(g + 3) % 4], w[(g + 2) % 4], 4);
+				current = _mm256_add_epi32(_mm256_add_epi32(w16, sigma0(w15)), w7);
+
+				// W[t - 2] for the first two words comes from the previous group,
+				// for the last two from the words just computed.
+				__m256i low = sigma1(_mm256_shuffle_epi32(w[(g + 3) % 4], 0xFE));
+				current = _mm256_add_epi32(current, _mm256_blend_epi32(_mm256_setzero_si256(), low, 0x33));
+				__m256i high = sigma1(_mm256_shuffle_epi32(current, 0x40));
+				current = _mm256_add_epi32(current, _mm256_blend_epi32(_mm256_setzero_si256(), high, 0xCC));
+			}
+
+			w[g % 4] = current;
+
+			__m256i k = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(SHA256::ROUND_CONSTANTS.data() + g * 4)));
+			_mm256_store_si256(reinterpret_cast<__m256i*>(schedule + 8 * g), _mm256_add_epi32(current, k));
+		}
+	}
+}
+
+JSRTP_TARGET("avx2")
+void SHA256::compress_blocks_avx2(state& h, const uint8_t* blocks, std::size_t count)
+{
+	alignas(32) uint32_t schedule[ROUNDS * 2];
+
+	while (count > 0)
+	{
+		const uint8_t* second = count > 1 ? blocks + BLOCK_SIZE : blocks;
+		schedule_pair(blocks, second, schedule);
+
+		compress_scheduled(h, schedule, 8);
+		if (count == 1)
+		{
+			break;
+		}
+
+		compress_scheduled(h, schedule + 4, 8);
+		blocks += 2 * BLOCK_SIZE;
+		count -= 2;
+	}
+}
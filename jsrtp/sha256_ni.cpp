@@ -0,0 +1,75 @@
+#include "hash.h"
+#include "cpu_features.h"
+#include <immintrin.h>
+#include <utility>
+
+namespace
+{
+	// Each group covers four rounds. While group g runs, the message words
+	// for groups g + 1 to g + 3 are completed with sha256msg1/sha256msg2.
+	template<int g>
+	JSRTP_TARGET("sha,sse4.1")
+	inline void sha256_ni_group(__m128i& abef, __m128i& cdgh, __m128i* msg, const uint8_t* block)
+	{
+		__m128i& current = msg[g % 4];
+
+		if constexpr (g < 4)
+		{
+			const __m128i byte_swap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+			current = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block + g * 16)), byte_swap);
+		}
+
+		__m128i wk = _mm_add_epi32(current, _mm_loadu_si128(reinterpret_cast<const __m128i*>(SHA256::ROUND_CONSTANTS.data() + g * 4)));
+		cdgh = _mm_sha256rnds2_epu32(cdgh, abef, wk);
+
+		if constexpr (g >= 3 && g <= 14)
+		{
+			__m128i& next = msg[(g + 1) % 4];
+			next = _mm_add_epi32(next, _mm_alignr_epi8(current, msg[(g + 3) % 4], 4));
+			next = _mm_sha256msg2_epu32(next, current);
+		}
+
+		abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(wk, 0x0E));
+
+		if constexpr (g >= 1 && g <= 12)
+		{
+			msg[(g + 3) % 4] = _mm_sha256msg1_epu32(msg[(g + 3) % 4], current);
+		}
+	}
+
+	template<std::size_t... g>
+	JSRTP_TARGET("sha,sse4.1")
+	inline void sha256_ni_groups(__m128i& abef, __m128i& cdgh, __m128i* msg, const uint8_t* block, std::index_sequence<g...>)
+	{
+		(sha256_ni_group<g>(abef, cdgh, msg, block), ...);
+	}
+}
+
+JSRTP_TARGET("sha,sse4.1")
+void SHA256::compress_blocks_ni(state& h, const uint8_t* blocks, std::size_t count)
+{
+	__m128i abcd = _mm_loadu_si128(reinterpret_cast<const __m128i*>(h.data()));
+	__m128i efgh = _mm_loadu_si128(reinterpret_cast<const __m128i*>(h.data() + 4));
+
+	__m128i cdab = _mm_shuffle_epi32(abcd, 0xB1);
+	__m128i hgfe = _mm_shuffle_epi32(efgh, 0x1B);
+	__m128i abef = _mm_alignr_epi8(cdab, hgfe, 8);
+	__m128i cdgh = _mm_blend_epi16(hgfe, cdab, 0xF0);
+
+	for (; count > 0; --count, blocks += BLOCK_SIZE)
+	{
+		__m128i abef_start = abef;
+		__m128i cdgh_start = cdgh;
+		__m128i msg[4];
+
+		sha256_ni_groups(abef, cdgh, msg, blocks, std::make_index_sequence<16>());
+
+		abef = _mm_add_epi32(abef, abef_start);
+		cdgh = _mm_add_epi32(cdgh, cdgh_start);
+	}
+
+	__m128i feba = _mm_shuffle_epi32(abef, 0x1B);
+	__m128i dchg = _mm_shuffle_epi32(cdgh, 0xB1);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(h.data()), _mm_blend_epi16(feba, dchg, 0xF0));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(h.data() + 4), _mm_alignr_epi8(dchg, feba, 8));
+}
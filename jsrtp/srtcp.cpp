@@ -0,0 +1,296 @@
+#include "srtcp.h"
+#include "srtp_batch.h"
+#include "byte_order.h"
+#include <stdexcept>
+#include <algorithm>
+
+SRTCPSession::SRTCPSession(std::size_t replay_window_size) : key_store(SRTPKeyDerivation::srtcp_label, salt_size, false), initial_replay(replay_window_size) {}
+
+std::size_t SRTCPSession::get_overhead()
+{
+	return index_size + tag_size;
+}
+
+uint32_t SRTCPSession::get_next_index(uint32_t ssrc) const
+{
+	auto stream = streams.find(ssrc);
+	return stream == streams.end() ? 0 : stream->second.next_index;
+}
+
+const SRTPRejectCounters& SRTCPSession::get_reject_counters() const
+{
+	return reject_counters;
+}
+
+void SRTCPSession::set_encryption(bool enabled)
+{
+	encrypt = enabled;
+}
+
+void SRTCPSession::set_session_keys(std::vector<uint8_t> encryption_key, std::vector<uint8_t> salt, std::vector<uint8_t> auth_key)
+{
+	if (encryption_key.size() != encryption_key_size)
+	{
+		throw std::invalid_argument("SRTCP encryption key must be 16 bytes");
+	}
+
+	if (salt.size() != salt_size)
+	{
+		throw std::invalid_argument("SRTCP salt must be 14 bytes");
+	}
+
+	if (auth_key.size() != auth_key_size)
+	{
+		throw std::invalid_argument("SRTCP authentication key must be 20 bytes");
+	}
+
+	key_store.set_session_keys(encryption_key.data(), salt.data(), auth_key.data());
+}
+
+void SRTCPSession::set_master_key(std::vector<uint8_t> master_key, std::vector<uint8_t> master_salt, uint64_t key_derivation_rate)
+{
+	key_store.set_master_key(std::move(master_key), std::move(master_salt), key_derivation_rate);
+}
+
+AES::state SRTCPSession::make_iv(const SRTPKeySet& keys, uint32_t ssrc, uint32_t index)
+{
+	AES::state iv = {};
+	std::copy(keys.salt.begin(), keys.salt.end(), iv.begin());
+
+	for (int i = 0; i < 4; ++i)
+	{
+		iv[4 + i] ^= static_cast<uint8_t>(ssrc >> (24 - 8 * i));
+		iv[10 + i] ^= static_cast<uint8_t>(index >> (24 - 8 * i));
+	}
+
+	return iv;
+}
+
+bool SRTCPSession::parse_compound(const uint8_t* packet, std::size_t len)
+{
+	if (len < rtcp_header_size)
+	{
+		return false;
+	}
+
+	std::size_t offset = 0;
+	while (offset + 4 <= len)
+	{
+		if ((packet[offset] >> 6) != rtcp_version)
+		{
+			return false;
+		}
+		offset += 4 + 4 * static_cast<std::size_t>(load_be16(packet + offset + 2));
+	}
+
+	return offset == len;
+}
+
+SRTPStatus SRTCPSession::prepare_protect(uint8_t* packet, std::size_t len, std::size_t capacity, PacketInfo& info)
+{
+	if (len > capacity || !parse_compound(packet, len))
+	{
+		return SRTPStatus::invalid_packet;
+	}
+
+	if (capacity - len < get_overhead())
+	{
+		return SRTPStatus::buffer_too_small;
+	}
+
+	info.rtcp_len = len;
+	info.ssrc = load_be32(packet + 4);
+	info.encrypted = encrypt;
+
+	Stream& stream = streams.try_emplace(info.ssrc, initial_replay).first->second;
+	if (stream.next_index > max_index)
+	{
+		return SRTPStatus::key_exhausted;
+	}
+
+	info.index = stream.next_index++;
+	store_be32(info.index | (info.encrypted ? encrypted_flag : 0), packet + len);
+
+	return SRTPStatus::ok;
+}
+
+SRTPStatus SRTCPSession::prepare_unprotect(const uint8_t* packet, std::size_t len, PacketInfo& info)
+{
+	if (len < rtcp_header_size + get_overhead() || (packet[0] >> 6) != rtcp_version)
+	{
+		return SRTPStatus::invalid_packet;
+	}
+
+	info.rtcp_len = len - get_overhead();
+	uint32_t trailer = load_be32(packet + info.rtcp_len);
+	info.encrypted = (trailer & encrypted_flag) != 0;
+	info.index = trailer & max_index;
+	info.ssrc = load_be32(packet + 4);
+
+	auto found = streams.find(info.ssrc);
+	if (found != streams.end() && !found->second.replay.check(info.index))
+	{
+		return SRTPStatus::replayed;
+	}
+
+	return SRTPStatus::ok;
+}
+
+SRTPStatus SRTCPSession::commit_unprotect(const PacketInfo& info)
+{
+	Stream& stream = streams.try_emplace(info.ssrc, initial_replay).first->second;
+	if (!stream.replay.update(info.index))
+	{
+		return SRTPStatus::replayed;
+	}
+
+	key_store.commit(info.index);
+	return SRTPStatus::ok;
+}
+
+SRTPStatus SRTCPSession::protect(ByteSlice buffer, std::size_t& len)
+{
+	uint8_t* packet = buffer.data();
+	PacketInfo info;
+
+	SRTPStatus status = prepare_protect(packet, len, buffer.size(), info);
+	if (status != SRTPStatus::ok)
+	{
+		return status;
+	}
+
+	SRTPKeySet& keys = key_store.get_keys(info.index);
+	key_store.commit(info.index);
+
+	if (info.encrypted)
+	{
+		keys.cipher.set_iv(make_iv(keys, info.ssrc, info.index));
+		keys.cipher.apply_keystream(packet + rtcp_header_size, len - rtcp_header_size);
+	}
+
+	keys.auth.append(packet, len + index_size);
+	keys.auth.get_digest(ByteSlice(packet + len + index_size, tag_size));
+
+	len += get_overhead();
+	return SRTPStatus::ok;
+}
+
+SRTPStatus SRTCPSession::unprotect(ByteSlice packet, std::size_t& len)
+{
+	SRTPStatus status = unprotect_packet(packet.data(), packet.size(), len);
+	reject_counters.count(status);
+	return status;
+}
+
+SRTPStatus SRTCPSession::unprotect_packet(uint8_t* data, std::size_t packet_len, std::size_t& len)
+{
+	PacketInfo info;
+
+	SRTPStatus status = prepare_unprotect(data, packet_len, info);
+	if (status != SRTPStatus::ok)
+	{
+		return status;
+	}
+
+	SRTPKeySet& keys = key_store.get_keys(info.index);
+
+	keys.auth.append(data, info.rtcp_len + index_size);
+	if (!keys.auth.verify(ConstByteSlice(data + info.rtcp_len + index_size, tag_size)))
+	{
+		return SRTPStatus::auth_failed;
+	}
+
+	status = commit_unprotect(info);
+	if (status != SRTPStatus::ok)
+	{
+		return status;
+	}
+
+	if (info.encrypted)
+	{
+		keys.cipher.set_iv(make_iv(keys, info.ssrc, info.index));
+		keys.cipher.apply_keystream(data + rtcp_header_size, info.rtcp_len - rtcp_header_size);
+	}
+
+	len = info.rtcp_len;
+	return SRTPStatus::ok;
+}
+
+void SRTCPSession::protect_batch(SRTCPPacket* packets, std::size_t count)
+{
+	SRTPBatch<SRTCPSession>::protect(packets, count);
+}
+
+void SRTCPSession::unprotect_batch(SRTCPPacket* packets, std::size_t count)
+{
+	SRTPBatch<SRTCPSession>::unprotect(packets, count);
+}
+
+void SRTCPSession::protect_run(SRTCPPacket** run, const PacketInfo* infos, std::size_t count)
+{
+	KeystreamBatch<max_batch> keystreams;
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		if (infos[i].encrypted)
+		{
+			keystreams.add(make_iv(*infos[i].keys, infos[i].ssrc, infos[i].index), run[i]->data + rtcp_header_size, infos[i].rtcp_len - rtcp_header_size);
+		}
+	}
+
+	keystreams.apply(infos[0].keys->cipher);
+
+	std::array<std::array<uint8_t, SHA1::DIGEST_SIZE>, max_batch> digests;
+	std::array<DigestRequest, max_batch> requests;
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		requests[i] = { run[i]->data, infos[i].rtcp_len + index_size, digests[i].data() };
+	}
+
+	infos[0].keys->auth.get_digests(requests.data(), count);
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		std::copy(digests[i].begin(), digests[i].begin() + tag_size, run[i]->data + infos[i].rtcp_len + index_size);
+		run[i]->len = infos[i].rtcp_len + get_overhead();
+	}
+}
+
+void SRTCPSession::unprotect_run(SRTCPPacket** run, const PacketInfo* infos, std::size_t count)
+{
+	std::array<std::array<uint8_t, SHA1::DIGEST_SIZE>, max_batch> digests;
+	std::array<DigestRequest, max_batch> requests;
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		requests[i] = { run[i]->data, infos[i].rtcp_len + index_size, digests[i].data() };
+	}
+
+	infos[0].keys->auth.get_digests(requests.data(), count);
+
+	KeystreamBatch<max_batch> keystreams;
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		if (!HMAC::tags_equal(digests[i].data(), run[i]->data + infos[i].rtcp_len + index_size, tag_size))
+		{
+			run[i]->status = SRTPStatus::auth_failed;
+			continue;
+		}
+
+		run[i]->status = commit_unprotect(infos[i]);
+		if (run[i]->status != SRTPStatus::ok)
+		{
+			continue;
+		}
+
+		run[i]->len = infos[i].rtcp_len;
+		if (infos[i].encrypted)
+		{
+			keystreams.add(make_iv(*infos[i].keys, infos[i].ssrc, infos[i].index), run[i]->data + rtcp_header_size, infos[i].rtcp_len - rtcp_header_size);
+		}
+	}
+
+	keystreams.apply(infos[0].keys->cipher);
+}
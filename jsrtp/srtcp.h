@@ -0,0 +1,100 @@
+#ifndef __SRTCP_H__
+#define __SRTCP_H__
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <unordered_map>
+#include "container_slice.h"
+#include "counter_mode.h"
+#include "hmac.h"
+#include "srtp.h"
+#include "srtp_kdf.h"
+#include "srtp_key_store.h"
+#include "replay_window.h"
+
+class SRTCPSession;
+
+struct SRTCPPacket
+{
+	SRTCPSession* session;
+	uint8_t* data;
+	std::size_t len;
+	std::size_t capacity;
+	SRTPStatus status;
+};
+
+// SRTCP for the AES-CM/HMAC-SHA1 profiles. Both profiles use an 80-bit tag
+// for SRTCP (RFC 4568), so the session has no profile of its own.
+class SRTCPSession
+{
+public:
+	constexpr static int rtcp_header_size = 8;
+	constexpr static int rtcp_version = 2;
+	constexpr static int encryption_key_size = SRTPSessionKeys::encryption_key_size;
+	constexpr static int salt_size = SRTPSessionKeys::salt_size;
+	constexpr static int auth_key_size = SRTPSessionKeys::auth_key_size;
+	constexpr static int index_size = 4;
+	constexpr static int tag_size = 10;
+	constexpr static uint32_t encrypted_flag = 0x80000000;
+	constexpr static uint32_t max_index = 0x7FFFFFFF;
+
+	SRTCPSession(std::size_t replay_window_size = ReplayWindow::min_size);
+
+	void set_master_key(std::vector<uint8_t> master_key, std::vector<uint8_t> master_salt, uint64_t key_derivation_rate = 0);
+	void set_session_keys(std::vector<uint8_t> encryption_key, std::vector<uint8_t> salt, std::vector<uint8_t> auth_key);
+	void set_encryption(bool enabled);
+
+	SRTPStatus protect(ByteSlice buffer, std::size_t& len);
+	SRTPStatus unprotect(ByteSlice packet, std::size_t& len);
+
+	static void protect_batch(SRTCPPacket* packets, std::size_t count);
+	static void unprotect_batch(SRTCPPacket* packets, std::size_t count);
+
+	const SRTPRejectCounters& get_reject_counters() const;
+	uint32_t get_next_index(uint32_t ssrc) const;
+
+	static std::size_t get_overhead();
+	static bool parse_compound(const uint8_t* packet, std::size_t len);
+
+private:
+	friend class SRTPBatch<SRTCPSession>;
+
+	using Packet = SRTCPPacket;
+
+	struct Stream
+	{
+		Stream(const ReplayWindow& in_replay) : replay(in_replay) {}
+
+		uint32_t next_index = 0;
+		ReplayWindow replay;
+	};
+
+	struct PacketInfo
+	{
+		std::size_t rtcp_len;
+		uint32_t ssrc;
+		uint32_t index;
+		bool encrypted;
+		SRTPKeySet* keys;
+	};
+
+	constexpr static std::size_t max_batch = 64;
+
+	SRTPKeyStore key_store;
+	std::unordered_map<uint32_t, Stream> streams;
+	ReplayWindow initial_replay;
+	bool encrypt = true;
+	SRTPRejectCounters reject_counters;
+
+	SRTPStatus prepare_protect(uint8_t* packet, std::size_t len, std::size_t capacity, PacketInfo& info);
+	SRTPStatus prepare_unprotect(const uint8_t* packet, std::size_t len, PacketInfo& info);
+	SRTPStatus commit_unprotect(const PacketInfo& info);
+	SRTPStatus unprotect_packet(uint8_t* data, std::size_t packet_len, std::size_t& len);
+	void protect_run(SRTCPPacket** run, const PacketInfo* infos, std::size_t count);
+	void unprotect_run(SRTCPPacket** run, const PacketInfo* infos, std::size_t count);
+
+	static AES::state make_iv(const SRTPKeySet& keys, uint32_t ssrc, uint32_t index);
+};
+
+#endif
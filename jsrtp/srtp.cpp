@@ -0,0 +1,707 @@
+#include "srtp.h"
+#include "srtp_batch.h"
+#include "byte_order.h"
+#include <stdexcept>
+#include <algorithm>
+
+void SRTPRejectCounters::count(SRTPStatus status)
+{
+	switch (status)
+	{
+	case SRTPStatus::invalid_packet:
+		++invalid_packet;
+		break;
+	case SRTPStatus::auth_failed:
+		++auth_failed;
+		break;
+	case SRTPStatus::replayed:
+		++replayed;
+		break;
+	default:
+		break;
+	}
+}
+
+SRTPSession::SRTPSession(SRTPProfile in_profile, std::size_t replay_window_size) : profile(in_profile), tag_size(get_tag_size(in_profile)),
+	key_store(SRTPKeyDerivation::srtp_label, is_aead() ? aead_salt_size : salt_size, is_aead()), initial_replay(replay_window_size) {}
+
+std::size_t SRTPSession::get_tag_size(SRTPProfile profile)
+{
+	switch (profile)
+	{
+	case SRTPProfile::aes128_cm_hmac_sha1_80:
+		return 10;
+	case SRTPProfile::aes128_cm_hmac_sha1_32:
+		return 4;
+	case SRTPProfile::aead_aes_128_gcm:
+		return AESGCM::tag_size;
+	default:
+		throw std::invalid_argument("Unknown SRTP profile");
+	}
+}
+
+std::size_t SRTPSession::get_tag_size() const
+{
+	return tag_size;
+}
+
+void SRTPSession::set_unprotect_mode(SRTPUnprotectMode mode)
+{
+	unprotect_mode = mode;
+}
+
+SRTPUnprotectMode SRTPSession::get_unprotect_mode() const
+{
+	return unprotect_mode;
+}
+
+const SRTPRejectCounters& SRTPSession::get_reject_counters() const
+{
+	return reject_counters;
+}
+
+void SRTPSession::reset_reject_counters()
+{
+	reject_counters = SRTPRejectCounters();
+}
+
+void SRTPSession::set_keystream_cache(std::size_t packets, std::size_t max_payload_size)
+{
+	if (packets > max_batch)
+	{
+		throw std::invalid_argument("SRTP keystream cache holds at most 64 packets");
+	}
+
+	keystream_cache_packets = max_payload_size == 0 ? 0 : packets;
+	keystream_cache_size = (max_payload_size + AES::block_size - 1) / AES::block_size * AES::block_size;
+
+	for (auto& stream : streams)
+	{
+		stream.second.keystream_cache.clear();
+		stream.second.cached_indices.clear();
+	}
+}
+
+// Fills the cache with keystream for the packets following the highest index
+// seen on the stream, stopping where the session keys would change.
+void SRTPSession::precompute_keystreams(uint32_t ssrc)
+{
+	auto found = streams.find(ssrc);
+	if (found == streams.end() || keystream_cache_packets == 0 || is_aead())
+	{
+		return;
+	}
+
+	Stream& stream = found->second;
+	if (stream.cached_indices.size() != keystream_cache_packets)
+	{
+		stream.keystream_cache.assign(keystream_cache_packets * keystream_cache_size, 0);
+		stream.cached_indices.assign(keystream_cache_packets, no_cached_index);
+	}
+
+	KeystreamBatch<max_batch> keystreams;
+	uint64_t next = ((static_cast<uint64_t>(stream.roc) << 16) | stream.highest_seq) + 1;
+	uint64_t r = key_store.get_r(next);
+	SRTPKeySet& keys = key_store.get_keys(next);
+
+	for (uint64_t index = next; index < next + keystream_cache_packets; ++index)
+	{
+		if (index > max_index || key_store.get_r(index) != r)
+		{
+			break;
+		}
+
+		std::size_t slot = index % keystream_cache_packets;
+		if (stream.cached_indices[slot] == index)
+		{
+			continue;
+		}
+
+		uint8_t* keystream = stream.keystream_cache.data() + slot * keystream_cache_size;
+		std::fill(keystream, keystream + keystream_cache_size, 0);
+		stream.cached_indices[slot] = index;
+
+		keystreams.add(make_iv(keys, ssrc, index), keystream, keystream_cache_size);
+	}
+
+	keystreams.apply(keys.cipher);
+}
+
+void SRTPSession::precompute_keystreams()
+{
+	for (auto& stream : streams)
+	{
+		precompute_keystreams(stream.first);
+	}
+}
+
+void SRTPSession::invalidate_keystream_caches()
+{
+	for (auto& stream : streams)
+	{
+		std::fill(stream.second.cached_indices.begin(), stream.second.cached_indices.end(), no_cached_index);
+	}
+}
+
+bool SRTPSession::is_aead() const
+{
+	return profile == SRTPProfile::aead_aes_128_gcm;
+}
+
+uint32_t SRTPSession::get_roc(uint32_t ssrc) const
+{
+	auto stream = streams.find(ssrc);
+	return stream == streams.end() ? 0 : stream->second.roc;
+}
+
+void SRTPSession::set_roc(uint32_t ssrc, uint32_t roc, uint16_t seq)
+{
+	Stream& stream = streams.try_emplace(ssrc, seq, initial_replay).first->second;
+	stream.roc = roc;
+	stream.highest_seq = seq;
+}
+
+uint64_t SRTPSession::get_current_r() const
+{
+	return key_store.get_current_r();
+}
+
+void SRTPSession::set_session_keys(std::vector<uint8_t> encryption_key, std::vector<uint8_t> salt, std::vector<uint8_t> auth_key)
+{
+	if (encryption_key.size() != encryption_key_size)
+	{
+		throw std::invalid_argument("SRTP encryption key must be 16 bytes");
+	}
+
+	if (is_aead())
+	{
+		if (salt.size() != aead_salt_size)
+		{
+			throw std::invalid_argument("SRTP AEAD salt must be 12 bytes");
+		}
+
+		if (!auth_key.empty())
+		{
+			throw std::invalid_argument("SRTP AEAD profiles do not use an authentication key");
+		}
+
+	}
+	else if (salt.size() != salt_size)
+	{
+		throw std::invalid_argument("SRTP salt must be 14 bytes");
+	}
+	else if (auth_key.size() != auth_key_size)
+	{
+		throw std::invalid_argument("SRTP authentication key must be 20 bytes");
+	}
+
+	key_store.set_session_keys(encryption_key.data(), salt.data(), auth_key.data());
+	invalidate_keystream_caches();
+}
+
+void SRTPSession::set_master_key(std::vector<uint8_t> master_key, std::vector<uint8_t> master_salt, uint64_t key_derivation_rate)
+{
+	// RFC 7714 uses a 96-bit master salt, zero padded to the KDF's 112 bits.
+	if (is_aead())
+	{
+		if (master_salt.size() != aead_salt_size)
+		{
+			throw std::invalid_argument("SRTP AEAD master salt must be 12 bytes");
+		}
+		master_salt.resize(SRTPKeyDerivation::master_salt_size);
+	}
+
+	key_store.set_master_key(std::move(master_key), std::move(master_salt), key_derivation_rate);
+	invalidate_keystream_caches();
+}
+
+bool SRTPSession::parse_header(const uint8_t* packet, std::size_t len, std::size_t& header_len)
+{
+	if (len < rtp_header_size || (packet[0] >> 6) != rtp_version)
+	{
+		return false;
+	}
+
+	header_len = rtp_header_size + 4 * (packet[0] & 0x0F);
+
+	if (packet[0] & 0x10)
+	{
+		if (header_len + 4 > len)
+		{
+			return false;
+		}
+		header_len += 4 + 4 * static_cast<std::size_t>(load_be16(packet + header_len + 2));
+	}
+
+	return header_len <= len;
+}
+
+int64_t SRTPSession::estimate_roc(const Stream& stream, uint16_t seq)
+{
+	int64_t roc = stream.roc;
+
+	if (stream.highest_seq < 32768)
+	{
+		if (seq - stream.highest_seq > 32768 && roc > 0)
+		{
+			return roc - 1;
+		}
+	}
+	else if (stream.highest_seq - 32768 > seq)
+	{
+		return roc + 1;
+	}
+
+	return roc;
+}
+
+void SRTPSession::update_stream(Stream& stream, int64_t roc, uint16_t seq)
+{
+	uint64_t index = (static_cast<uint64_t>(roc) << 16) | seq;
+	uint64_t highest = (static_cast<uint64_t>(stream.roc) << 16) | stream.highest_seq;
+
+	if (index > highest)
+	{
+		stream.roc = static_cast<uint32_t>(roc);
+		stream.highest_seq = seq;
+	}
+}
+
+AES::state SRTPSession::make_iv(const SRTPKeySet& keys, uint32_t ssrc, uint64_t index)
+{
+	AES::state iv = {};
+	std::copy(keys.salt.begin(), keys.salt.end(), iv.begin());
+
+	for (int i = 0; i < 4; ++i)
+	{
+		iv[4 + i] ^= static_cast<uint8_t>(ssrc >> (24 - 8 * i));
+	}
+
+	for (int i = 0; i < 6; ++i)
+	{
+		iv[8 + i] ^= static_cast<uint8_t>(index >> (40 - 8 * i));
+	}
+
+	return iv;
+}
+
+std::array<uint8_t, AESGCM::iv_size> SRTPSession::make_aead_iv(const SRTPKeySet& keys, uint32_t ssrc, uint64_t index)
+{
+	std::array<uint8_t, AESGCM::iv_size> iv;
+	std::copy(keys.salt.begin(), keys.salt.begin() + aead_salt_size, iv.begin());
+
+	for (int i = 0; i < 4; ++i)
+	{
+		iv[2 + i] ^= static_cast<uint8_t>(ssrc >> (24 - 8 * i));
+	}
+
+	for (int i = 0; i < 6; ++i)
+	{
+		iv[6 + i] ^= static_cast<uint8_t>(index >> (40 - 8 * i));
+	}
+
+	return iv;
+}
+
+void SRTPSession::seal(uint8_t* packet, const PacketInfo& info)
+{
+	auto iv = make_aead_iv(*info.keys, info.ssrc, info.index);
+	info.keys->aead.encrypt(iv.data(), ConstByteSlice(packet, info.header_len), ByteSlice(packet + info.header_len, info.auth_len - info.header_len), packet + info.auth_len);
+}
+
+bool SRTPSession::open(uint8_t* packet, const PacketInfo& info)
+{
+	auto iv = make_aead_iv(*info.keys, info.ssrc, info.index);
+	return info.keys->aead.decrypt(iv.data(), ConstByteSlice(packet, info.header_len), ByteSlice(packet + info.header_len, info.auth_len - info.header_len), packet + info.auth_len);
+}
+
+// Each cached keystream is used at most once.
+bool SRTPSession::apply_cached_keystream(uint8_t* packet, const PacketInfo& info)
+{
+	std::size_t payload_len = info.auth_len - info.header_len;
+	if (keystream_cache_packets == 0 || payload_len > keystream_cache_size)
+	{
+		return false;
+	}
+
+	auto found = streams.find(info.ssrc);
+	if (found == streams.end() || found->second.cached_indices.empty())
+	{
+		return false;
+	}
+
+	Stream& stream = found->second;
+	std::size_t slot = info.index % keystream_cache_packets;
+	if (stream.cached_indices[slot] != info.index)
+	{
+		return false;
+	}
+
+	const uint8_t* keystream = stream.keystream_cache.data() + slot * keystream_cache_size;
+	uint8_t* payload = packet + info.header_len;
+	for (std::size_t i = 0; i < payload_len; ++i)
+	{
+		payload[i] ^= keystream[i];
+	}
+
+	stream.cached_indices[slot] = no_cached_index;
+	return true;
+}
+
+void SRTPSession::transform_payload(uint8_t* packet, const PacketInfo& info)
+{
+	AESCounterMode& cipher = info.keys->cipher;
+	cipher.set_iv(make_iv(*info.keys, info.ssrc, info.index));
+	cipher.apply_keystream(packet + info.header_len, info.auth_len - info.header_len);
+}
+
+void SRTPSession::encrypt_and_authenticate(uint8_t* packet, const PacketInfo& info, uint8_t* tag)
+{
+	AESCounterMode& cipher = info.keys->cipher;
+	HMACFixed<SHA1>& auth = info.keys->auth;
+	cipher.set_iv(make_iv(*info.keys, info.ssrc, info.index));
+
+	for (std::size_t offset = 0; offset < info.auth_len; offset += fused_chunk_size)
+	{
+		std::size_t end = std::min<std::size_t>(offset + fused_chunk_size, info.auth_len);
+		std::size_t start = std::max(offset, info.header_len);
+
+		if (start < end)
+		{
+			cipher.apply_keystream(packet + start, end - start);
+		}
+		auth.append(packet + offset, end - offset);
+	}
+
+	finish_tag(info, tag);
+}
+
+bool SRTPSession::authenticate_and_decrypt(uint8_t* packet, const PacketInfo& info)
+{
+	AESCounterMode& cipher = info.keys->cipher;
+	HMACFixed<SHA1>& auth = info.keys->auth;
+	cipher.set_iv(make_iv(*info.keys, info.ssrc, info.index));
+
+	for (std::size_t offset = 0; offset < info.auth_len; offset += fused_chunk_size)
+	{
+		std::size_t end = std::min<std::size_t>(offset + fused_chunk_size, info.auth_len);
+		std::size_t start = std::max(offset, info.header_len);
+
+		auth.append(packet + offset, end - offset);
+		if (start < end)
+		{
+			cipher.apply_keystream(packet + start, end - start);
+		}
+	}
+
+	append_roc(auth, static_cast<uint32_t>(info.roc));
+	return auth.verify(ConstByteSlice(packet + info.auth_len, tag_size));
+}
+
+bool SRTPSession::authenticate(const uint8_t* packet, const PacketInfo& info)
+{
+	HMACFixed<SHA1>& auth = info.keys->auth;
+	auth.append(packet, info.auth_len);
+	append_roc(auth, static_cast<uint32_t>(info.roc));
+	return auth.verify(ConstByteSlice(packet + info.auth_len, tag_size));
+}
+
+void SRTPSession::finish_tag(const PacketInfo& info, uint8_t* tag)
+{
+	append_roc(info.keys->auth, static_cast<uint32_t>(info.roc));
+	info.keys->auth.get_digest(ByteSlice(tag, tag_size));
+}
+
+void SRTPSession::append_roc(HMACFixed<SHA1>& auth, uint32_t roc)
+{
+	std::array<uint8_t, roc_size> roc_bytes;
+	store_be32(roc, roc_bytes.data());
+	auth.append(roc_bytes.data(), roc_bytes.size());
+}
+
+SRTPStatus SRTPSession::prepare_protect(const uint8_t* packet, std::size_t len, std::size_t capacity, PacketInfo& info)
+{
+	if (len > capacity || !parse_header(packet, len, info.header_len))
+	{
+		return SRTPStatus::invalid_packet;
+	}
+
+	if (capacity - len < tag_size)
+	{
+		return SRTPStatus::buffer_too_small;
+	}
+
+	info.auth_len = len;
+	info.seq = load_be16(packet + 2);
+	info.ssrc = load_be32(packet + 8);
+
+	auto inserted = streams.try_emplace(info.ssrc, info.seq, initial_replay);
+	Stream& stream = inserted.first->second;
+
+	info.roc = estimate_roc(stream, info.seq);
+	info.index = (static_cast<uint64_t>(info.roc) << 16) | info.seq;
+	if (info.index > max_index)
+	{
+		return SRTPStatus::key_exhausted;
+	}
+
+	update_stream(stream, info.roc, info.seq);
+
+	return SRTPStatus::ok;
+}
+
+SRTPStatus SRTPSession::prepare_unprotect(const uint8_t* packet, std::size_t len, PacketInfo& info)
+{
+	if (len < tag_size)
+	{
+		return SRTPStatus::invalid_packet;
+	}
+
+	info.auth_len = len - tag_size;
+	if (!parse_header(packet, info.auth_len, info.header_len))
+	{
+		return SRTPStatus::invalid_packet;
+	}
+
+	info.seq = load_be16(packet + 2);
+	info.ssrc = load_be32(packet + 8);
+
+	auto found = streams.find(info.ssrc);
+	info.roc = found == streams.end() ? 0 : estimate_roc(found->second, info.seq);
+	info.index = (static_cast<uint64_t>(info.roc) << 16) | info.seq;
+	if (info.index > max_index)
+	{
+		return SRTPStatus::key_exhausted;
+	}
+
+	if (found != streams.end() && !found->second.replay.check(info.index))
+	{
+		return SRTPStatus::replayed;
+	}
+
+	return SRTPStatus::ok;
+}
+
+SRTPStatus SRTPSession::commit_unprotect(const PacketInfo& info)
+{
+	auto inserted = streams.try_emplace(info.ssrc, info.seq, initial_replay);
+	Stream& stream = inserted.first->second;
+
+	if (!stream.replay.update(info.index))
+	{
+		return SRTPStatus::replayed;
+	}
+
+	update_stream(stream, info.roc, info.seq);
+	key_store.commit(info.index);
+	return SRTPStatus::ok;
+}
+
+SRTPStatus SRTPSession::protect(ByteSlice buffer, std::size_t& len)
+{
+	uint8_t* packet = buffer.data();
+	PacketInfo info;
+
+	SRTPStatus status = prepare_protect(packet, len, buffer.size(), info);
+	if (status != SRTPStatus::ok)
+	{
+		return status;
+	}
+
+	info.keys = &key_store.get_keys(info.index);
+	key_store.commit(info.index);
+
+	if (is_aead())
+	{
+		seal(packet, info);
+	}
+	else if (apply_cached_keystream(packet, info))
+	{
+		info.keys->auth.append(packet, len);
+		finish_tag(info, packet + len);
+	}
+	else
+	{
+		encrypt_and_authenticate(packet, info, packet + len);
+	}
+
+	len += tag_size;
+	return SRTPStatus::ok;
+}
+
+SRTPStatus SRTPSession::unprotect(ByteSlice packet, std::size_t& len)
+{
+	SRTPStatus status = unprotect_packet(packet.data(), packet.size(), len);
+	reject_counters.count(status);
+	return status;
+}
+
+SRTPStatus SRTPSession::unprotect_packet(uint8_t* data, std::size_t packet_len, std::size_t& len)
+{
+	PacketInfo info;
+
+	SRTPStatus status = prepare_unprotect(data, packet_len, info);
+	if (status != SRTPStatus::ok)
+	{
+		return status;
+	}
+
+	info.keys = &key_store.get_keys(info.index);
+
+	if (is_aead())
+	{
+		if (!open(data, info))
+		{
+			return SRTPStatus::auth_failed;
+		}
+
+		status = commit_unprotect(info);
+		if (status != SRTPStatus::ok)
+		{
+			return status;
+		}
+
+		len = info.auth_len;
+		return SRTPStatus::ok;
+	}
+
+	if (unprotect_mode == SRTPUnprotectMode::authenticate_first || keystream_cache_packets > 0)
+	{
+		if (!authenticate(data, info))
+		{
+			return SRTPStatus::auth_failed;
+		}
+
+		status = commit_unprotect(info);
+		if (status != SRTPStatus::ok)
+		{
+			return status;
+		}
+
+		if (!apply_cached_keystream(data, info))
+		{
+			transform_payload(data, info);
+		}
+		len = info.auth_len;
+		return SRTPStatus::ok;
+	}
+
+	if (!authenticate_and_decrypt(data, info))
+	{
+		transform_payload(data, info);
+		return SRTPStatus::auth_failed;
+	}
+
+	status = commit_unprotect(info);
+	if (status != SRTPStatus::ok)
+	{
+		transform_payload(data, info);
+		return status;
+	}
+
+	len = info.auth_len;
+	return SRTPStatus::ok;
+}
+
+void SRTPSession::protect_batch(SRTPPacket* packets, std::size_t count)
+{
+	SRTPBatch<SRTPSession>::protect(packets, count);
+}
+
+void SRTPSession::unprotect_batch(SRTPPacket* packets, std::size_t count)
+{
+	SRTPBatch<SRTPSession>::unprotect(packets, count);
+}
+
+void SRTPSession::protect_run(SRTPPacket** run, const PacketInfo* infos, std::size_t count)
+{
+	if (is_aead())
+	{
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			seal(run[i]->data, infos[i]);
+			run[i]->len = infos[i].auth_len + tag_size;
+		}
+		return;
+	}
+
+	KeystreamBatch<max_batch> keystreams;
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		keystreams.add(make_iv(*infos[i].keys, infos[i].ssrc, infos[i].index), run[i]->data + infos[i].header_len, infos[i].auth_len - infos[i].header_len);
+	}
+
+	keystreams.apply(infos[0].keys->cipher);
+
+	std::array<std::array<uint8_t, SHA1::DIGEST_SIZE>, max_batch> digests;
+	std::array<DigestRequest, max_batch> requests;
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		store_be32(static_cast<uint32_t>(infos[i].roc), run[i]->data + infos[i].auth_len);
+		requests[i] = { run[i]->data, infos[i].auth_len + roc_size, digests[i].data() };
+	}
+
+	infos[0].keys->auth.get_digests(requests.data(), count);
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		std::copy(digests[i].begin(), digests[i].begin() + tag_size, run[i]->data + infos[i].auth_len);
+		run[i]->len = infos[i].auth_len + tag_size;
+	}
+}
+
+void SRTPSession::unprotect_run(SRTPPacket** run, const PacketInfo* infos, std::size_t count)
+{
+	if (is_aead())
+	{
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			run[i]->status = open(run[i]->data, infos[i]) ? commit_unprotect(infos[i]) : SRTPStatus::auth_failed;
+			if (run[i]->status == SRTPStatus::ok)
+			{
+				run[i]->len = infos[i].auth_len;
+			}
+		}
+		return;
+	}
+
+	std::array<std::array<uint8_t, max_tag_size>, max_batch> received;
+	std::array<std::array<uint8_t, SHA1::DIGEST_SIZE>, max_batch> digests;
+	std::array<DigestRequest, max_batch> requests;
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		uint8_t* tag = run[i]->data + infos[i].auth_len;
+		std::copy(tag, tag + tag_size, received[i].begin());
+		store_be32(static_cast<uint32_t>(infos[i].roc), tag);
+		requests[i] = { run[i]->data, infos[i].auth_len + roc_size, digests[i].data() };
+	}
+
+	infos[0].keys->auth.get_digests(requests.data(), count);
+
+	KeystreamBatch<max_batch> keystreams;
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		std::copy(received[i].begin(), received[i].begin() + tag_size, run[i]->data + infos[i].auth_len);
+
+		if (!HMAC::tags_equal(digests[i].data(), received[i].data(), tag_size))
+		{
+			run[i]->status = SRTPStatus::auth_failed;
+			continue;
+		}
+
+		run[i]->status = commit_unprotect(infos[i]);
+		if (run[i]->status != SRTPStatus::ok)
+		{
+			continue;
+		}
+
+		keystreams.add(make_iv(*infos[i].keys, infos[i].ssrc, infos[i].index), run[i]->data + infos[i].header_len, infos[i].auth_len - infos[i].header_len);
+		run[i]->len = infos[i].auth_len;
+	}
+
+	keystreams.apply(infos[0].keys->cipher);
+}
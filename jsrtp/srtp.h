@@ -0,0 +1,177 @@
+#ifndef __SRTP_H__
+#define __SRTP_H__
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <unordered_map>
+#include "container_slice.h"
+#include "counter_mode.h"
+#include "hmac.h"
+#include "gcm.h"
+#include "srtp_kdf.h"
+#include "srtp_key_store.h"
+#include "replay_window.h"
+
+enum class SRTPProfile
+{
+	aes128_cm_hmac_sha1_80,
+	aes128_cm_hmac_sha1_32,
+	aead_aes_128_gcm
+};
+
+enum class SRTPStatus
+{
+	ok,
+	invalid_packet,
+	buffer_too_small,
+	auth_failed,
+	replayed,
+	key_exhausted
+};
+
+enum class SRTPUnprotectMode
+{
+	fused,
+	authenticate_first
+};
+
+struct SRTPRejectCounters
+{
+	uint64_t invalid_packet = 0;
+	uint64_t auth_failed = 0;
+	uint64_t replayed = 0;
+
+	void count(SRTPStatus status);
+};
+
+class SRTPSession;
+
+template<class Session>
+class SRTPBatch;
+
+struct SRTPPacket
+{
+	SRTPSession* session;
+	uint8_t* data;
+	std::size_t len;
+	std::size_t capacity;
+	SRTPStatus status;
+};
+
+class SRTPSession
+{
+public:
+	constexpr static int rtp_header_size = 12;
+	constexpr static int rtp_version = 2;
+	constexpr static int encryption_key_size = SRTPSessionKeys::encryption_key_size;
+	constexpr static int salt_size = SRTPSessionKeys::salt_size;
+	constexpr static int auth_key_size = SRTPSessionKeys::auth_key_size;
+	constexpr static int aead_salt_size = 12;
+	constexpr static int roc_size = 4;
+	constexpr static uint64_t max_index = (1ULL << 48) - 1;
+
+	SRTPSession(SRTPProfile in_profile = SRTPProfile::aes128_cm_hmac_sha1_80, std::size_t replay_window_size = ReplayWindow::min_size);
+
+	void set_master_key(std::vector<uint8_t> master_key, std::vector<uint8_t> master_salt, uint64_t key_derivation_rate = 0);
+	void set_session_keys(std::vector<uint8_t> encryption_key, std::vector<uint8_t> salt, std::vector<uint8_t> auth_key);
+
+	SRTPStatus protect(ByteSlice buffer, std::size_t& len);
+	SRTPStatus unprotect(ByteSlice packet, std::size_t& len);
+
+	static void protect_batch(SRTPPacket* packets, std::size_t count);
+	static void unprotect_batch(SRTPPacket* packets, std::size_t count);
+
+	void set_unprotect_mode(SRTPUnprotectMode mode);
+	SRTPUnprotectMode get_unprotect_mode() const;
+	const SRTPRejectCounters& get_reject_counters() const;
+	void reset_reject_counters();
+
+	// Keystream for the next packets of a stream can be generated before they
+	// arrive, so protect and unprotect of those packets only XOR and
+	// authenticate. Not used by the AEAD profile or the batch calls.
+	// Precomputing uses the session's cipher and streams, so it must run on
+	// the thread that protects or unprotects for the session, e.g. between
+	// packets, and never concurrently with them.
+	void set_keystream_cache(std::size_t packets, std::size_t max_payload_size);
+	void precompute_keystreams(uint32_t ssrc);
+	void precompute_keystreams();
+
+	std::size_t get_tag_size() const;
+	bool is_aead() const;
+	uint32_t get_roc(uint32_t ssrc) const;
+	// Starts or resynchronises a stream at a ROC signalled out of band, with
+	// seq the highest sequence number sent or received under it.
+	void set_roc(uint32_t ssrc, uint32_t roc, uint16_t seq);
+	uint64_t get_current_r() const;
+
+	static std::size_t get_tag_size(SRTPProfile profile);
+	static bool parse_header(const uint8_t* packet, std::size_t len, std::size_t& header_len);
+
+private:
+	friend class SRTPBatch<SRTPSession>;
+
+	using Packet = SRTPPacket;
+
+	struct Stream
+	{
+		Stream(uint16_t seq, const ReplayWindow& in_replay) : highest_seq(seq), replay(in_replay) {}
+
+		uint32_t roc = 0;
+		uint16_t highest_seq = 0;
+		ReplayWindow replay;
+		std::vector<uint8_t> keystream_cache;
+		std::vector<uint64_t> cached_indices;
+	};
+
+	struct PacketInfo
+	{
+		std::size_t header_len;
+		std::size_t auth_len;
+		uint32_t ssrc;
+		uint16_t seq;
+		int64_t roc;
+		uint64_t index;
+		SRTPKeySet* keys;
+	};
+
+	constexpr static std::size_t max_batch = 64;
+	constexpr static std::size_t max_tag_size = AESGCM::tag_size;
+	constexpr static std::size_t fused_chunk_size = AESCounterMode::batch_size;
+	constexpr static uint64_t no_cached_index = ~0ULL;
+
+	SRTPProfile profile;
+	std::size_t tag_size;
+	SRTPKeyStore key_store;
+	std::unordered_map<uint32_t, Stream> streams;
+	ReplayWindow initial_replay;
+	SRTPUnprotectMode unprotect_mode = SRTPUnprotectMode::fused;
+	SRTPRejectCounters reject_counters;
+	std::size_t keystream_cache_packets = 0;
+	std::size_t keystream_cache_size = 0;
+
+	static int64_t estimate_roc(const Stream& stream, uint16_t seq);
+	static void update_stream(Stream& stream, int64_t roc, uint16_t seq);
+
+	SRTPStatus prepare_protect(const uint8_t* packet, std::size_t len, std::size_t capacity, PacketInfo& info);
+	SRTPStatus prepare_unprotect(const uint8_t* packet, std::size_t len, PacketInfo& info);
+	SRTPStatus commit_unprotect(const PacketInfo& info);
+	SRTPStatus unprotect_packet(uint8_t* data, std::size_t packet_len, std::size_t& len);
+	void protect_run(SRTPPacket** run, const PacketInfo* infos, std::size_t count);
+	void unprotect_run(SRTPPacket** run, const PacketInfo* infos, std::size_t count);
+
+	static AES::state make_iv(const SRTPKeySet& keys, uint32_t ssrc, uint64_t index);
+	static std::array<uint8_t, AESGCM::iv_size> make_aead_iv(const SRTPKeySet& keys, uint32_t ssrc, uint64_t index);
+	void seal(uint8_t* packet, const PacketInfo& info);
+	bool open(uint8_t* packet, const PacketInfo& info);
+	void invalidate_keystream_caches();
+	bool apply_cached_keystream(uint8_t* packet, const PacketInfo& info);
+	void transform_payload(uint8_t* packet, const PacketInfo& info);
+	void encrypt_and_authenticate(uint8_t* packet, const PacketInfo& info, uint8_t* tag);
+	bool authenticate_and_decrypt(uint8_t* packet, const PacketInfo& info);
+	bool authenticate(const uint8_t* packet, const PacketInfo& info);
+	void finish_tag(const PacketInfo& info, uint8_t* tag);
+	static void append_roc(HMACFixed<SHA1>& auth, uint32_t roc);
+};
+
+#endif
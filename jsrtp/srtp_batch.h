@@ -0,0 +1,100 @@
+#ifndef __SRTP_BATCH_H__
+#define __SRTP_BATCH_H__
+
+#include <cstdint>
+#include <array>
+#include "srtp.h"
+
+// Batch protect/unprotect shared by SRTPSession and SRTCPSession. Packets are
+// prepared one by one and grouped into runs of consecutive packets of one
+// session whose indices share a key derivation window, which the session then
+// processes together with protect_run/unprotect_run.
+template<class Session>
+class SRTPBatch
+{
+public:
+	using Packet = typename Session::Packet;
+
+	static void protect(Packet* packets, std::size_t count)
+	{
+		process(packets, count, true);
+	}
+
+	static void unprotect(Packet* packets, std::size_t count)
+	{
+		process(packets, count, false);
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			packets[i].session->reject_counters.count(packets[i].status);
+		}
+	}
+
+private:
+	using PacketInfo = typename Session::PacketInfo;
+
+	static void process(Packet* packets, std::size_t count, bool protect)
+	{
+		std::array<Packet*, Session::max_batch> run;
+		std::array<PacketInfo, Session::max_batch> infos;
+		std::size_t run_len = 0;
+		uint64_t run_r = 0;
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			Session& session = *packets[i].session;
+			PacketInfo info;
+
+			if (protect)
+			{
+				packets[i].status = session.prepare_protect(packets[i].data, packets[i].len, packets[i].capacity, info);
+			}
+			else
+			{
+				packets[i].status = session.prepare_unprotect(packets[i].data, packets[i].len, info);
+			}
+
+			if (packets[i].status != SRTPStatus::ok)
+			{
+				continue;
+			}
+
+			uint64_t r = session.key_store.get_r(info.index);
+			if (run_len > 0 && (run_len == Session::max_batch || run[0]->session != &session || r != run_r))
+			{
+				process_run(run.data(), infos.data(), run_len, protect);
+				run_len = 0;
+			}
+
+			// Unprotect runs commit their keys once the packets authenticate.
+			run_r = r;
+			info.keys = &session.key_store.get_keys(info.index);
+			if (protect)
+			{
+				session.key_store.commit(info.index);
+			}
+
+			run[run_len] = &packets[i];
+			infos[run_len++] = info;
+		}
+
+		if (run_len > 0)
+		{
+			process_run(run.data(), infos.data(), run_len, protect);
+		}
+	}
+
+	static void process_run(Packet** run, const PacketInfo* infos, std::size_t count, bool protect)
+	{
+		if (protect)
+		{
+			run[0]->session->protect_run(run, infos, count);
+		}
+		else
+		{
+			run[0]->session->unprotect_run(run, infos, count);
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,68 @@
+#include "srtp_kdf.h"
+#include <stdexcept>
+
+SRTPKeyDerivation::SRTPKeyDerivation() : aes(AES::create(AESImplementation::automatic)) {}
+
+void SRTPKeyDerivation::set_master_key(std::vector<uint8_t> master_key, std::vector<uint8_t> in_master_salt, uint64_t key_derivation_rate)
+{
+	if (master_key.size() != master_key_size)
+	{
+		throw std::invalid_argument("SRTP master key must be 16 bytes");
+	}
+
+	if (in_master_salt.size() != master_salt_size)
+	{
+		throw std::invalid_argument("SRTP master salt must be 14 bytes");
+	}
+
+	if (key_derivation_rate > max_key_derivation_rate || (key_derivation_rate & (key_derivation_rate - 1)) != 0)
+	{
+		throw std::invalid_argument("SRTP key derivation rate must be zero or a power of two up to 2^24");
+	}
+
+	rate_shift = -1;
+	for (uint64_t rate = key_derivation_rate; rate != 0; rate >>= 1)
+	{
+		++rate_shift;
+	}
+
+	aes->set_key(std::move(master_key));
+	std::copy(in_master_salt.begin(), in_master_salt.end(), master_salt.begin());
+}
+
+uint64_t SRTPKeyDerivation::get_r(uint64_t index) const
+{
+	return rate_shift < 0 ? 0 : index >> rate_shift;
+}
+
+void SRTPKeyDerivation::set_iv(uint8_t label, uint64_t r, uint8_t counter, uint8_t* block) const
+{
+	std::copy(master_salt.begin(), master_salt.end(), block);
+	block[7] ^= label;
+	for (int i = 0; i < 6; ++i)
+	{
+		block[8 + i] ^= static_cast<uint8_t>(r >> (40 - 8 * i));
+	}
+	block[14] = 0;
+	block[15] = counter;
+}
+
+void SRTPKeyDerivation::derive_session_keys(uint8_t first_label, uint64_t index, SRTPSessionKeys& keys)
+{
+	alignas(16) std::array<uint8_t, session_key_blocks * AES::block_size> blocks;
+	uint64_t r = get_r(index);
+
+	set_iv(first_label, r, 0, blocks.data());
+	set_iv(first_label + 1, r, 0, blocks.data() + AES::block_size);
+	set_iv(first_label + 1, r, 1, blocks.data() + 2 * AES::block_size);
+	set_iv(first_label + 2, r, 0, blocks.data() + 3 * AES::block_size);
+
+	aes->encrypt_blocks(blocks.data(), session_key_blocks);
+
+	auto block = blocks.begin();
+	std::copy(block, block + keys.encryption_key.size(), keys.encryption_key.begin());
+	block += AES::block_size;
+	std::copy(block, block + keys.auth_key.size(), keys.auth_key.begin());
+	block += 2 * AES::block_size;
+	std::copy(block, block + keys.salt.size(), keys.salt.begin());
+}
@@ -0,0 +1,46 @@
+#ifndef __SRTP_KDF_H__
+#define __SRTP_KDF_H__
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <memory>
+#include "cipher.h"
+
+struct SRTPSessionKeys
+{
+	constexpr static int encryption_key_size = 16;
+	constexpr static int auth_key_size = 20;
+	constexpr static int salt_size = 14;
+
+	std::array<uint8_t, encryption_key_size> encryption_key = {};
+	std::array<uint8_t, auth_key_size> auth_key = {};
+	std::array<uint8_t, salt_size> salt = {};
+};
+
+class SRTPKeyDerivation
+{
+public:
+	constexpr static int master_key_size = 16;
+	constexpr static int master_salt_size = 14;
+	constexpr static uint64_t max_key_derivation_rate = 1 << 24;
+	constexpr static uint8_t srtp_label = 0;
+	constexpr static uint8_t srtcp_label = 3;
+
+	SRTPKeyDerivation();
+
+	void set_master_key(std::vector<uint8_t> master_key, std::vector<uint8_t> in_master_salt, uint64_t key_derivation_rate = 0);
+	void derive_session_keys(uint8_t first_label, uint64_t index, SRTPSessionKeys& keys);
+	uint64_t get_r(uint64_t index) const;
+
+private:
+	constexpr static int session_key_blocks = 4;
+
+	std::unique_ptr<AES> aes;
+	std::array<uint8_t, master_salt_size> master_salt = {};
+	int rate_shift = -1;
+
+	void set_iv(uint8_t label, uint64_t r, uint8_t counter, uint8_t* block) const;
+};
+
+#endif
@@ -0,0 +1,107 @@
+#include "srtp_key_store.h"
+#include <algorithm>
+
+SRTPKeyStore::SRTPKeyStore(uint8_t in_label, std::size_t in_salt_size, bool in_aead) : label(in_label), salt_size(in_salt_size), aead(in_aead) {}
+
+void SRTPKeyStore::set_master_key(std::vector<uint8_t> master_key, std::vector<uint8_t> master_salt, uint64_t key_derivation_rate)
+{
+	kdf.set_master_key(std::move(master_key), std::move(master_salt), key_derivation_rate);
+	use_kdf = true;
+
+	for (auto& slot : slots)
+	{
+		slot.valid = false;
+	}
+
+	get_keys(0);
+	commit(0);
+}
+
+void SRTPKeyStore::set_session_keys(const uint8_t* encryption_key, const uint8_t* salt, const uint8_t* auth_key)
+{
+	use_kdf = false;
+
+	for (auto& slot : slots)
+	{
+		slot.valid = false;
+	}
+
+	load(slots[0], 0, encryption_key, salt, auth_key);
+	commit(0);
+}
+
+uint64_t SRTPKeyStore::get_r(uint64_t index) const
+{
+	return use_kdf ? kdf.get_r(index) : 0;
+}
+
+uint64_t SRTPKeyStore::get_current_r() const
+{
+	return current_r;
+}
+
+SRTPKeySet& SRTPKeyStore::get_keys(uint64_t index)
+{
+	if (!use_kdf)
+	{
+		return slots[0].keys;
+	}
+
+	uint64_t r = kdf.get_r(index);
+	Slot* slot = find_slot(r);
+	if (slot != nullptr)
+	{
+		return slot->keys;
+	}
+
+	slot = &*std::min_element(slots.begin(), slots.end(), [](const Slot& a, const Slot& b) {
+		return a.valid == b.valid ? a.last_used < b.last_used : !a.valid;
+	});
+
+	SRTPSessionKeys session_keys;
+	kdf.derive_session_keys(label, index, session_keys);
+	load(*slot, r, session_keys.encryption_key.data(), session_keys.salt.data(), session_keys.auth_key.data());
+	return slot->keys;
+}
+
+void SRTPKeyStore::commit(uint64_t index)
+{
+	uint64_t r = get_r(index);
+	Slot* slot = find_slot(r);
+	if (slot != nullptr)
+	{
+		slot->last_used = ++use_count;
+		current_r = r;
+	}
+}
+
+SRTPKeyStore::Slot* SRTPKeyStore::find_slot(uint64_t r)
+{
+	for (auto& slot : slots)
+	{
+		if (slot.valid && slot.r == r)
+		{
+			return &slot;
+		}
+	}
+
+	return nullptr;
+}
+
+void SRTPKeyStore::load(Slot& slot, uint64_t r, const uint8_t* encryption_key, const uint8_t* salt, const uint8_t* auth_key)
+{
+	if (aead)
+	{
+		slot.keys.aead.set_key(encryption_key, SRTPSessionKeys::encryption_key_size);
+	}
+	else
+	{
+		slot.keys.cipher.set_key(encryption_key, SRTPSessionKeys::encryption_key_size);
+		slot.keys.auth.set_key(auth_key, SRTPSessionKeys::auth_key_size);
+	}
+
+	std::copy(salt, salt + salt_size, slot.keys.salt.begin());
+	slot.r = r;
+	slot.last_used = 0;
+	slot.valid = true;
+}
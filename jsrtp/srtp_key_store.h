@@ -0,0 +1,62 @@
+#ifndef __SRTP_KEY_STORE_H__
+#define __SRTP_KEY_STORE_H__
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include "counter_mode.h"
+#include "hmac.h"
+#include "gcm.h"
+#include "srtp_kdf.h"
+
+struct SRTPKeySet
+{
+	AESCounterMode cipher;
+	HMACFixed<SHA1> auth;
+	AESGCM aead;
+	std::array<uint8_t, SRTPSessionKeys::salt_size> salt = {};
+};
+
+// Session keys for the key derivation windows (values of r) in use. Keys for
+// a window that is not cached are derived into the least recently used slot
+// and only count as used once commit() is called, which callers do after the
+// packet authenticated. A forged packet therefore costs at most one
+// derivation and never evicts the keys of the two most recent windows.
+class SRTPKeyStore
+{
+public:
+	constexpr static std::size_t slot_count = 3;
+
+	SRTPKeyStore(uint8_t in_label, std::size_t in_salt_size, bool in_aead);
+
+	void set_master_key(std::vector<uint8_t> master_key, std::vector<uint8_t> master_salt, uint64_t key_derivation_rate);
+	void set_session_keys(const uint8_t* encryption_key, const uint8_t* salt, const uint8_t* auth_key);
+
+	uint64_t get_r(uint64_t index) const;
+	uint64_t get_current_r() const;
+	SRTPKeySet& get_keys(uint64_t index);
+	void commit(uint64_t index);
+
+private:
+	struct Slot
+	{
+		SRTPKeySet keys;
+		uint64_t r = 0;
+		uint64_t last_used = 0;
+		bool valid = false;
+	};
+
+	uint8_t label;
+	std::size_t salt_size;
+	bool aead;
+	SRTPKeyDerivation kdf;
+	bool use_kdf = false;
+	std::array<Slot, slot_count> slots;
+	uint64_t use_count = 0;
+	uint64_t current_r = 0;
+
+	Slot* find_slot(uint64_t r);
+	void load(Slot& slot, uint64_t r, const uint8_t* encryption_key, const uint8_t* salt, const uint8_t* auth_key);
+};
+
+#endif